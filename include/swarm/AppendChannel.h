@@ -0,0 +1,183 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_APPENDCHANNEL_H_INCLUDED
+#define	SWARM_APPENDCHANNEL_H_INCLUDED
+
+
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "Poco/Channel.h"
+#include "Poco/Message.h"
+
+
+namespace swarm
+{
+  class AppendChannel : public Poco::Channel
+  {
+  public:
+    enum
+    {
+      DEFAULT_MAX_RECORD_SIZE = 64 * 1024, /// Default largest record written in one piece
+      DROP_CACHE_WINDOW = 8 * 1024 * 1024 /// Bytes written between page cache drops
+    };
+    
+    AppendChannel(const std::string& path);
+    ///
+    /// Creates a channel that appends to the file at path.  The file is
+    /// opened with O_APPEND and every record, including its newline, is
+    /// emitted by a single write() so that records from several processes
+    /// sharing the file never interleave.  No locking is involved.
+    ///
+    
+    void open();
+    ///
+    /// Open the file, creating it if needed.  Throws OpenFileException
+    ///
+    
+    void close();
+    ///
+    /// Flush the file to disk and close it.  Callers waiting in sync()
+    /// are released.
+    ///
+    
+    void log(const Poco::Message& msg);
+    ///
+    /// Write the message text as one record
+    ///
+    
+    void write(std::string& record);
+    ///
+    /// Write a formatted record.  The newline is appended to record,
+    /// which is used as the write buffer.  Throws WriteFileException.
+    /// This is not a thread safe call, the caller serializes writes.
+    ///
+    
+    unsigned long long written() const;
+    ///
+    /// Returns the number of records written so far
+    ///
+    
+    void sync(unsigned long long records, unsigned int windowMicroseconds);
+    ///
+    /// Block until the first records records are on disk.  Concurrent
+    /// callers share one fdatasync(): the first caller waits for the
+    /// batching window so that more records can join, then syncs every
+    /// record written so far on behalf of all of them.  Throws
+    /// WriteFileException if fdatasync() fails.  Thread safe.
+    ///
+    
+    void setMaxRecordSize(std::size_t size);
+    ///
+    /// Set the size of the largest record written in one piece.  Longer
+    /// records are cut to this size, including a "[truncated]" marker
+    /// and the newline, so that they are still atomic.  Regular files on
+    /// Linux accept writes of any size atomically with respect to other
+    /// O_APPEND writers, network file systems often do not.
+    /// Default:  64 KB
+    ///
+    
+    void setPreallocation(std::size_t chunk);
+    ///
+    /// Reserve disk space ahead of the writes in chunks of the given
+    /// size with fallocate(FALLOC_FL_KEEP_SIZE), so the file system
+    /// allocates large extents instead of a few blocks per write.  The
+    /// file size is not changed.  The unused tail is released when the
+    /// file is closed.  Trimming assumes a single writer: do not enable
+    /// it when other processes append to the same file.  0 disables
+    /// preallocation.  Linux only.
+    /// Default:  0
+    ///
+    
+    void enableDropCache(bool enable);
+    ///
+    /// Keep the log out of the page cache.  Every DROP_CACHE_WINDOW bytes
+    /// the window just written is queued for writeback and the window
+    /// before it, by then on disk, is dropped with
+    /// posix_fadvise(POSIX_FADV_DONTNEED).
+    /// Default:  false
+    ///
+    
+    std::size_t getMaxRecordSize() const;
+    ///
+    /// Returns the size of the largest record written in one piece
+    ///
+    
+    const std::string& getPath() const;
+    ///
+    /// Returns the path of the file
+    ///
+    
+  protected:
+    ~AppendChannel();
+    
+    void preallocate(std::size_t length);
+    ///
+    /// Reserve the next chunk if length more bytes do not fit
+    ///
+    
+    void dropCache(bool all);
+    ///
+    /// Queue the new data for writeback and drop what is on disk
+    ///
+    
+  private:
+    std::string _path; /// Path of the file
+    int _fd; /// The file descriptor.  -1 if closed
+    std::size_t _maxRecordSize; /// Largest record written in one piece
+    std::string _buffer; /// Write buffer of log()
+    boost::mutex _mutex; /// Serializes log()
+    boost::atomic<unsigned long long> _written; /// Records written
+    unsigned long long _synced; /// Records known to be on disk
+    bool _syncing; /// A caller is running fdatasync() for the group
+    boost::mutex _syncMutex; /// Guards the sync state
+    boost::condition_variable _syncCondition; /// Signals the end of a group sync
+    std::size_t _preallocation; /// Size of the fallocate() chunks.  0 if disabled
+    bool _dropCache; /// Drop written ranges from the page cache
+    unsigned long long _size; /// End of the file as seen by this channel
+    unsigned long long _allocated; /// End of the space reserved by fallocate()
+    unsigned long long _writebackStart; /// Start of the range not yet queued for writeback
+    unsigned long long _dropStart; /// Start of the range not yet dropped from the cache
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline std::size_t AppendChannel::getMaxRecordSize() const
+  {
+    return _maxRecordSize;
+  }
+  
+  inline unsigned long long AppendChannel::written() const
+  {
+    return _written.load(boost::memory_order_acquire);
+  }
+  
+  inline const std::string& AppendChannel::getPath() const
+  {
+    return _path;
+  }
+
+} // swarm
+
+
+#endif	// SWARM_APPENDCHANNEL_H_INCLUDED
+
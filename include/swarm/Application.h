@@ -25,14 +25,21 @@
 #include <boost/noncopyable.hpp>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 #include <Poco/Util/OptionSet.h>
 
 #include "swarm/Exception.h"
+#include "swarm/ConfigKey.h"
+#include "swarm/WorkerPool.h"
+#include "swarm/EventLoop.h"
+#include "swarm/TimerWheel.h"
 
 
 namespace swarm
 {
-  
+  class Logger;
   
   class Application : boost::noncopyable
   {
@@ -74,6 +81,15 @@ namespace swarm
     typedef boost::function<void()> InitCallback;
     typedef std::vector<std::string> Keys;
     
+    struct StartupPhase
+    {
+      std::string name;
+      unsigned long long start; /// Nanoseconds since run() was called
+      unsigned long long duration; /// Nanoseconds
+    };
+    
+    typedef std::vector<StartupPhase> StartupTimeline;
+    
     Application();
     
     ~Application();
@@ -92,7 +108,8 @@ namespace swarm
     
     void loadConfiguration(const std::string& path);
 		/// Loads configuration information from the file specified by
-		/// the given path. The file type is determined by the file
+		/// the given path and rebuilds the configuration snapshot.
+		/// The file type is determined by the file
 		/// extension. The following extensions are supported:
 		///   - .properties - properties file
 		///   - .ini        - initialization file
@@ -103,6 +120,17 @@ namespace swarm
 		/// The configuration will be added to the application's 
 		/// LayeredConfiguration.
     
+    const StartupTimeline& getStartupTimeline() const;
+      /// Returns the phases of the last run() startup:  options,
+      /// configuration, initialize, workers, init-callback, every
+      /// loadConfiguration() call made before the init callback returned
+      /// and the total.  The timeline is also logged once the init
+      /// callback returns if a logger is open.
+    
+    std::string formatStartupTimeline() const;
+      /// Returns the startup timeline as text, e.g.
+      /// options 0.210 ms, configuration 1.532 ms, ..., total 4.100 ms
+    
     void setInitCallback(const InitCallback& callback);
       /// Set a callback to be called when application initializes
     
@@ -112,14 +140,94 @@ namespace swarm
     void setReinitCallback(const InitCallback& callback);
       /// Set a callback to be called for application reinitialize.
       /// In Unix systems, this callback is called when a HUP signal is 
-      /// intercepted.  If not set, a HUP signal will terminate the application
+      /// intercepted.  If neither this callback nor a logger is set,
+      /// a HUP signal will terminate the application
     
     void setTerminateCallback(const InitCallback& callback);
       /// Set a callback to be called for application termination signal
     
+    void setUser1Callback(const InitCallback& callback);
+      /// Set a callback to be called on the event loop thread when a USR1
+      /// signal is received, e.g. to dump statistics.  Set it before
+      /// run(); without a callback the signal keeps its default action.
+    
+    void setUser2Callback(const InitCallback& callback);
+      /// Set a callback to be called on the event loop thread when a USR2
+      /// signal is received, e.g. to flush the logs.  Set it before
+      /// run(); without a callback the signal keeps its default action.
+    
+    TimerWheel& timerWheel();
+      /// Returns the timer wheel of the application.  The event loop
+      /// advances it every timer-wheel.resolution-ms milliseconds (default
+      /// 10, read before the init callback).  The expired callbacks run on
+      /// the worker pool if it is running, otherwise on the event loop
+      /// thread.
+    
+#if defined(__linux__)
+    EventLoop& eventLoop();
+      /// Returns the event loop run by the main thread of the daemon.  It
+      /// receives the signals through a signalfd and dispatches the HUP,
+      /// USR1, USR2 and termination callbacks.  Applications may add their
+      /// own file descriptors and timers to run housekeeping on the same
+      /// thread, from the init callback or any other thread.
+#endif
+    
+    void setLogger(Logger* pLogger, const std::string& prefix = "logger");
+      /// Attach a logger to the application.  The logger settings are
+      /// read from the configuration after it is loaded and again on every
+      /// reinitialize (HUP signal), after the reinit callback returns:
+      ///   - <prefix>.path              - path of the log file
+      ///   - <prefix>.priority          - priority name or number
+      ///   - <prefix>.format            - format of the log headers
+      ///   - <prefix>.purge-count       - rotated files to keep.  0 disables rotation
+      ///   - <prefix>.verification      - reopen the log file if it is deleted
+      ///   - <prefix>.call-site-control - swarm::LogCallSite control file
+      ///   - <prefix>.sink              - file, or append for files shared by processes
+      ///   - <prefix>.max-record-size   - largest atomic record in append mode
+      ///   - <prefix>.preallocate       - bytes reserved ahead of the writes in append mode
+      ///   - <prefix>.drop-page-cache   - keep the log out of the page cache in append mode
+      ///   - <prefix>.durable-priority  - priority synced to disk before returning, or none
+      ///   - <prefix>.sync-window-us    - group commit batching window in microseconds
+      ///   - <prefix>.watcher           - verify the log file from a background thread
+      ///   - <prefix>.exception-log     - priority of the per class exception log, or none
+      ///   - <prefix>.thread.cpus       - CPU list for the logger threads, e.g. 0,2-3
+      ///   - <prefix>.thread.policy     - other, batch, idle, fifo or rr
+      ///   - <prefix>.thread.priority   - realtime priority (fifo, rr) or nice value
+      ///   - <prefix>.thread.io-class   - none, realtime, best-effort or idle
+      ///   - <prefix>.thread.io-level   - I/O priority within the class, 0 to 7
+      /// Logging threads are not blocked while the logger is rebuilt.
+    
+    Logger* getLogger() const;
+      /// Returns the logger attached by setLogger() or null
+    
+    bool reloadLogger();
+      /// Re-read the logger settings from the configuration and apply them.
+      /// Returns false if no logger is attached, no path is configured
+      /// or the settings could not be applied.
+    
+    WorkerPool& workerPool();
+      /// Returns the worker pool of the application.  The pool is started
+      /// before the init callback if the configuration sets:
+      ///   - worker-pool.threads         - number of workers, 0 for one per CPU
+      ///   - worker-pool.thread.cpus     - CPU list for the workers, e.g. 0,2-3
+      ///   - worker-pool.thread.policy   - other, batch, idle, fifo or rr
+      ///   - worker-pool.thread.priority - realtime priority (fifo, rr) or nice value
+      ///   - worker-pool.thread.io-class - none, realtime, best-effort or idle
+      ///   - worker-pool.thread.io-level - I/O priority within the class, 0 to 7
+      /// Applications may also start it themselves.  The pool is drained
+      /// after the terminate callback returns.
+    
     void formatHelp(const std::string& usage, const std::string& header, std::ostream& strm);
       /// Format the registered options and write it to the output stream
     
+    //
+    // The getters below read an immutable, pre-parsed snapshot of the
+    // configuration without locking.  The snapshot is rebuilt when the
+    // application initializes, after loadConfiguration(), the setters
+    // and the reinit callback (HUP signal).  Keys under system. change
+    // by themselves and are always looked up in the live configuration.
+    //
+    
     bool hasProperty(const std::string& key) const;
 		/// Returns true iff the property with the given key exists.
 	
@@ -202,6 +310,7 @@ namespace swarm
     void setString(const std::string& key, const std::string& value);
 		/// Sets the property with the given key to the given value.
 		/// An already existing value for the key is overwritten.
+		/// Every setter rebuilds the configuration snapshot.
 		
     void setInt(const std::string& key, int value);
 		/// Sets the property with the given key to the given value.
@@ -222,6 +331,17 @@ namespace swarm
 		/// Returns in range the names of all subkeys under the given key.
 		/// If an empty key is passed, all root level keys are returned.
     
+    template <typename T>
+    ConfigKey<T> key(const std::string& name, const ConfigSlot::ChangeCallback& callback = ConfigSlot::ChangeCallback());
+		/// Returns a handle to the value of the given key, parsed as int,
+		/// double, bool or std::string.  Reading the handle is an atomic
+		/// load of the value parsed when the snapshot was rebuilt.  Handles
+		/// on the same key share their value and stay valid as long as the
+		/// application.  Handles on system. keys are only refreshed with
+		/// the snapshot.
+		/// The callback, if any, is called with the key name by the thread
+		/// that rebuilt the snapshot whenever the value changes.
+    
   protected:
     friend class Daemon;
     
@@ -237,17 +357,83 @@ namespace swarm
     
     bool& stopProcessing();
     
+    void rebuildSnapshot();
+      /// Re-read the whole configuration into a new snapshot and publish it
+    
+    void updateSnapshot(const std::string& key);
+      /// Publish a copy of the snapshot with the key and the values
+      /// referencing other keys re-read
+    
+    bool startWorkerPool();
+      /// Start the worker pool if the configuration sizes it
+    
+    void startTimerWheel();
+      /// Apply the configured resolution to the timer wheel
+    
+    void recordStartupPhase(const std::string& name, Clock::Ticks start);
+      /// Add a phase that started at the given ticks and ends now, unless
+      /// the startup is over
+    
+    void finishStartup();
+      /// Close the startup timeline and log it
+    
+    void readThreadOptions(const std::string& prefix, ThreadOptions& threadOptions) const;
+      /// Read the <prefix>cpus, policy, priority, io-class and io-level
+      /// keys into threadOptions.  Unset keys keep the current value.
+      /// Throws a SyntaxException if a value is invalid.
+    
   protected:
     InitCallback _initCallback;
     InitCallback _uninitCallback;
     InitCallback _reinitCallback;
     InitCallback _terminateCallback;
+    InitCallback _user1Callback;
+    InitCallback _user2Callback;
     
   private:
+    struct ConfigValue;
+    struct Snapshot;
+    
+    typedef std::map<std::string, ConfigSlot*> ConfigSlots;
+    
+    ConfigSlot* slot(const std::string& key, const ConfigSlot::ChangeCallback& callback);
+      /// Returns the slot of the key, creating and filling it on first use
+    
+    void dispatchTimer(const TimerWheel::Callback& callback);
+      /// Queue an expired timer on the worker pool or run it
+    
+    void publishSnapshot(const boost::shared_ptr<const Snapshot>& pSnapshot, std::vector<ConfigSlot::ChangeCallback>& callbacks, std::vector<std::string>& changed);
+      /// Replace the current snapshot and refill the slots.  Collects the
+      /// callbacks of the changed slots.  Requires _rebuildMutex.
+    
+    bool fillSlot(ConfigSlot& slot, const Snapshot& snapshot);
+      /// Store the value of the slot's key in the slot.  Returns true if
+      /// the value changed.
+    
+    bool lookup(const std::string& key, const ConfigValue*& pValue) const;
+      /// Find a key in the snapshot of the calling thread.  Returns false
+      /// if the live configuration must be used instead, otherwise sets
+      /// pValue to the value or null if the key does not exist.
+    
+    Logger* _pLogger;
+    std::string _loggerPrefix;
     OptionCallbackMap _optionCallbacks;
     OptionList _options;
     MainCallback _mainCallback;
     bool _stopProcessing;
+    WorkerPool _workerPool;
+    TimerWheel _timerWheel;
+    Clock::Ticks _startupTicks; /// Ticks when run() was called
+    bool _startupDone; /// True once the init callback returned
+    StartupTimeline _startupTimeline;
+#if defined(__linux__)
+    EventLoop _eventLoop;
+#endif
+    boost::shared_ptr<const Snapshot> _pSnapshot; /// Current snapshot.  Guarded by _snapshotMutex
+    mutable boost::mutex _snapshotMutex;
+    boost::atomic<unsigned int> _snapshotVersion; /// Incremented when _pSnapshot is replaced
+    ConfigSlots _configSlots; /// Guarded by _rebuildMutex
+    boost::mutex _rebuildMutex; /// Serializes rebuildSnapshot() and updateSnapshot()
   };
   
   //
@@ -298,6 +484,55 @@ namespace swarm
   {
     _terminateCallback = callback;
   }
+  
+  inline void Application::setUser1Callback(const InitCallback& callback)
+  {
+    _user1Callback = callback;
+  }
+  
+  inline void Application::setUser2Callback(const InitCallback& callback)
+  {
+    _user2Callback = callback;
+  }
+  
+  inline void Application::setLogger(Logger* pLogger, const std::string& prefix)
+  {
+    _pLogger = pLogger;
+    _loggerPrefix = prefix;
+  }
+  
+  inline Logger* Application::getLogger() const
+  {
+    return _pLogger;
+  }
+  
+  inline WorkerPool& Application::workerPool()
+  {
+    return _workerPool;
+  }
+  
+  inline const Application::StartupTimeline& Application::getStartupTimeline() const
+  {
+    return _startupTimeline;
+  }
+  
+  inline TimerWheel& Application::timerWheel()
+  {
+    return _timerWheel;
+  }
+  
+#if defined(__linux__)
+  inline EventLoop& Application::eventLoop()
+  {
+    return _eventLoop;
+  }
+#endif
+  
+  template <typename T>
+  inline ConfigKey<T> Application::key(const std::string& name, const ConfigSlot::ChangeCallback& callback)
+  {
+    return ConfigKey<T>(slot(name, callback));
+  }
 
 
 } // swarm
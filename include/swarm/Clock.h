@@ -0,0 +1,126 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_CLOCK_H_INCLUDED
+#define	SWARM_CLOCK_H_INCLUDED
+
+
+#include <ctime>
+#include <time.h>
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SWARM_CLOCK_HAS_TSC 1
+#else
+#define SWARM_CLOCK_HAS_TSC 0
+#endif
+
+
+namespace swarm
+{
+  class Clock
+  {
+  public:
+    typedef unsigned long long Ticks;
+    
+    static bool enableTsc(bool enable);
+    ///
+    /// Enable/Disable the invariant TSC as the tick source.  The TSC rate
+    /// is measured against CLOCK_MONOTONIC_RAW and the offset to the wall
+    /// clock is taken from CLOCK_REALTIME when enabled and periodically
+    /// while timestamps are converted.  Returns true if the
+    /// TSC is in use after the call.  Ticks taken before and after the
+    /// switch are not comparable so this must be called during startup,
+    /// before any thread starts logging.
+    /// Default:  false (CLOCK_MONOTONIC)
+    ///
+    
+    static bool isTscEnabled();
+    ///
+    /// Returns true if ticks are read from the TSC
+    ///
+    
+    static bool hasInvariantTsc();
+    ///
+    /// Returns true if the CPU advertises an invariant TSC
+    ///
+    
+    static Ticks ticks();
+    ///
+    /// Returns the current tick count.  This is the cheap call that
+    /// should be used on hot paths.  Ticks are converted to
+    /// time only when needed.
+    ///
+    
+    static unsigned long long nanoseconds(Ticks elapsed);
+    ///
+    /// Converts a tick interval to nanoseconds
+    ///
+    
+    static unsigned long long realtime(Ticks ticks);
+    ///
+    /// Converts a tick count to nanoseconds since the epoch
+    ///
+    
+    static std::time_t epochTime();
+    ///
+    /// Returns the current time in seconds since the epoch
+    ///
+    
+    static void calibrate();
+    ///
+    /// Refresh the TSC rate and the CLOCK_REALTIME offset.  This is done
+    /// automatically and is only exposed for applications that
+    /// know the wall clock has been stepped.
+    ///
+    
+  private:
+    static Ticks monotonic();
+    
+    static bool _tscEnabled; /// True if ticks are read from the TSC
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline bool Clock::isTscEnabled()
+  {
+    return _tscEnabled;
+  }
+  
+  inline Clock::Ticks Clock::monotonic()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (Ticks)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  
+  inline Clock::Ticks Clock::ticks()
+  {
+#if SWARM_CLOCK_HAS_TSC
+    if (_tscEnabled)
+      return __builtin_ia32_rdtsc();
+#endif
+    return monotonic();
+  }
+
+} // swarm
+
+
+#endif	// SWARM_CLOCK_H_INCLUDED
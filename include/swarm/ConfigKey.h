@@ -0,0 +1,238 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_CONFIGKEY_H_INCLUDED
+#define	SWARM_CONFIGKEY_H_INCLUDED
+
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "swarm/Exception.h"
+
+
+namespace swarm
+{
+  class ConfigSlot : boost::noncopyable
+  {
+  public:
+    typedef boost::function<void(const std::string&)> ChangeCallback;
+    
+    explicit ConfigSlot(const std::string& key);
+    ///
+    /// Creates the slot of a configuration key.  Slots are created and
+    /// owned by the swarm::Application
+    ///
+    
+    const std::string& key() const;
+    ///
+    /// Returns the name of the configuration key
+    ///
+    
+    bool exists() const;
+    ///
+    /// Returns true if the key exists in the configuration
+    ///
+    
+    bool load(int& value) const;
+    bool load(double& value) const;
+    bool load(bool& value) const;
+    bool load(std::string& value) const;
+    ///
+    /// Set value to the parsed value of the key.  Returns false if the
+    /// key does not exist or can not be converted to the type.
+    ///
+    
+  private:
+    friend class Application;
+    
+    enum Flags
+    {
+      HAS_KEY = 0x01,
+      HAS_STRING = 0x02,
+      HAS_INT = 0x04,
+      HAS_DOUBLE = 0x08,
+      HAS_BOOL = 0x10
+    };
+    
+    std::string _key;
+    boost::atomic<unsigned int> _flags; /// Flags of the values that parsed
+    boost::atomic<int> _int;
+    boost::atomic<boost::uint64_t> _double; /// Bit pattern of the double
+    boost::atomic<bool> _bool;
+    boost::shared_ptr<const std::string> _pString; /// Read with boost::atomic_load
+    std::vector<ChangeCallback> _callbacks; /// Guarded by the application
+  };
+  
+  template <typename T>
+  class ConfigKey
+  {
+  public:
+    ConfigKey();
+    ///
+    /// Creates an unbound handle.  Use swarm::Application::key() to get
+    /// a bound one.
+    ///
+    
+    explicit ConfigKey(const ConfigSlot* pSlot);
+    ///
+    /// Creates a handle reading the given slot
+    ///
+    
+    const std::string& key() const;
+    ///
+    /// Returns the name of the configuration key
+    ///
+    
+    bool exists() const;
+    ///
+    /// Returns true if the key exists in the configuration
+    ///
+    
+    T get() const;
+    ///
+    /// Returns the value of the key, parsed as the matching
+    /// swarm::Application getter would.
+    /// Throws a NotFoundException if the key does not exist.
+    /// Throws a SyntaxException if the value can not be converted to T.
+    ///
+    
+    T get(const T& defaultValue) const;
+    ///
+    /// Returns the value of the key or the default value if the key
+    /// does not exist.
+    /// Throws a SyntaxException if the value can not be converted to T.
+    ///
+    
+  private:
+    const ConfigSlot* _pSlot;
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline ConfigSlot::ConfigSlot(const std::string& key) :
+    _key(key),
+    _flags(0),
+    _int(0),
+    _double(0),
+    _bool(false)
+  {
+  }
+  
+  inline const std::string& ConfigSlot::key() const
+  {
+    return _key;
+  }
+  
+  inline bool ConfigSlot::exists() const
+  {
+    return (_flags.load(boost::memory_order_acquire) & HAS_KEY) != 0;
+  }
+  
+  inline bool ConfigSlot::load(int& value) const
+  {
+    if (!(_flags.load(boost::memory_order_acquire) & HAS_INT))
+      return false;
+    value = _int.load(boost::memory_order_relaxed);
+    return true;
+  }
+  
+  inline bool ConfigSlot::load(double& value) const
+  {
+    if (!(_flags.load(boost::memory_order_acquire) & HAS_DOUBLE))
+      return false;
+    boost::uint64_t bits = _double.load(boost::memory_order_relaxed);
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+  }
+  
+  inline bool ConfigSlot::load(bool& value) const
+  {
+    if (!(_flags.load(boost::memory_order_acquire) & HAS_BOOL))
+      return false;
+    value = _bool.load(boost::memory_order_relaxed);
+    return true;
+  }
+  
+  inline bool ConfigSlot::load(std::string& value) const
+  {
+    if (!(_flags.load(boost::memory_order_acquire) & HAS_STRING))
+      return false;
+    boost::shared_ptr<const std::string> pString = boost::atomic_load(&_pString);
+    value = *pString;
+    return true;
+  }
+  
+  template <typename T>
+  inline ConfigKey<T>::ConfigKey() :
+    _pSlot(0)
+  {
+  }
+  
+  template <typename T>
+  inline ConfigKey<T>::ConfigKey(const ConfigSlot* pSlot) :
+    _pSlot(pSlot)
+  {
+  }
+  
+  template <typename T>
+  inline const std::string& ConfigKey<T>::key() const
+  {
+    return _pSlot->key();
+  }
+  
+  template <typename T>
+  inline bool ConfigKey<T>::exists() const
+  {
+    return _pSlot->exists();
+  }
+  
+  template <typename T>
+  inline T ConfigKey<T>::get() const
+  {
+    T value = T();
+    if (_pSlot->load(value))
+      return value;
+    if (!_pSlot->exists())
+      throw swarm::NotFoundException(_pSlot->key());
+    throw swarm::SyntaxException(_pSlot->key());
+  }
+  
+  template <typename T>
+  inline T ConfigKey<T>::get(const T& defaultValue) const
+  {
+    T value = T();
+    if (_pSlot->load(value))
+      return value;
+    if (!_pSlot->exists())
+      return defaultValue;
+    throw swarm::SyntaxException(_pSlot->key());
+  }
+  
+} // swarm
+
+
+#endif	// SWARM_CONFIGKEY_H_INCLUDED
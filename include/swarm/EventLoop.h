@@ -0,0 +1,160 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_EVENTLOOP_H_INCLUDED
+#define	SWARM_EVENTLOOP_H_INCLUDED
+
+
+#include <map>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+namespace swarm
+{
+  class EventLoop : boost::noncopyable
+  {
+  public:
+    typedef boost::function<void(int /*fd*/, unsigned int /*events*/)> FdCallback;
+    typedef boost::function<void(int /*signal*/)> SignalCallback;
+    typedef boost::function<void()> TimerCallback;
+    typedef int TimerId;
+    
+    EventLoop();
+    ///
+    /// Creates the epoll instance.  Throws a SystemException if the
+    /// kernel refuses it.
+    ///
+    
+    ~EventLoop();
+    ///
+    /// Closes the timers and the signal descriptor.  The file descriptors
+    /// added with addFd() are left open.
+    ///
+    
+    bool addFd(int fd, unsigned int events, const FdCallback& callback);
+    ///
+    /// Call the callback with the ready events whenever the descriptor has
+    /// one of the given epoll events, e.g. EPOLLIN.  Returns false if the
+    /// descriptor is already registered or can not be polled.
+    ///
+    
+    bool modifyFd(int fd, unsigned int events);
+    ///
+    /// Change the events watched on a registered descriptor
+    ///
+    
+    bool removeFd(int fd);
+    ///
+    /// Stop watching the descriptor.  Call it before closing it.
+    ///
+    
+    bool addSignal(int signal, const SignalCallback& callback);
+    ///
+    /// Receive the signal through a signalfd.  The signal is blocked for
+    /// the calling thread, so it must also be blocked in every other
+    /// thread, best before they are created.  Replaces the previous
+    /// callback of the signal.
+    ///
+    
+    bool removeSignal(int signal);
+    ///
+    /// Stop receiving the signal.  It stays blocked.
+    ///
+    
+    TimerId addTimer(unsigned long initialMilliseconds, unsigned long intervalMilliseconds, const TimerCallback& callback);
+    ///
+    /// Call the callback after initialMilliseconds, then every
+    /// intervalMilliseconds, or only once if the interval is 0.  Expirations
+    /// missed while the loop was busy are reported as one call.  Returns
+    /// the timer or -1 on failure.
+    ///
+    
+    bool cancelTimer(TimerId timer);
+    ///
+    /// Stop and release the timer
+    ///
+    
+    void run();
+    ///
+    /// Dispatch events on the calling thread until stop() is called
+    ///
+    
+    bool runOnce(int timeoutMilliseconds);
+    ///
+    /// Dispatch the events ready within the timeout, -1 waits forever.
+    /// Returns false once stop() was called.
+    ///
+    
+    void stop();
+    ///
+    /// Make run() return.  Safe to call from any thread or callback.
+    ///
+    
+    bool isStopped() const;
+    ///
+    /// Returns true if stop() was called
+    ///
+    
+  private:
+    enum HandlerType
+    {
+      HANDLER_FD,
+      HANDLER_TIMER,
+      HANDLER_SIGNAL,
+      HANDLER_WAKEUP
+    };
+    
+    struct Handler
+    {
+      HandlerType type;
+      FdCallback fdCallback;
+      TimerCallback timerCallback;
+      bool oneShot;
+    };
+    
+    typedef std::map<int, Handler> Handlers;
+    typedef std::map<int, SignalCallback> SignalCallbacks;
+    
+    bool add(int fd, unsigned int events, const Handler& handler);
+    void dispatch(int fd, unsigned int events);
+    
+    int _epollFd;
+    int _wakeupFd; /// eventfd written by stop()
+    int _signalFd; /// -1 until a signal is added
+    Handlers _handlers; /// Guarded by _mutex
+    SignalCallbacks _signalCallbacks; /// Guarded by _mutex
+    mutable boost::mutex _mutex;
+    boost::atomic<bool> _stopped;
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline bool EventLoop::isStopped() const
+  {
+    return _stopped.load(boost::memory_order_acquire);
+  }
+  
+} // swarm
+
+
+#endif	// SWARM_EVENTLOOP_H_INCLUDED
@@ -22,9 +22,15 @@
 
 
 #include <stdexcept>
+#include <string>
+#if __cplusplus >= 201103L
+#include <utility>
+#endif
 #include <boost/system/system_error.hpp>
 #include <boost/system/error_code.hpp>
 
+#include "swarm/ExceptionStats.h"
+
 
 
 namespace swarm {
@@ -35,6 +41,11 @@ class Exception: public std::exception
 	/// in the SWARM class library.
 {
 public:
+	enum
+	{
+		MAX_STACK_DEPTH = 32 /// Return addresses kept by the stack capture
+	};
+
 	Exception(const std::string& msg, int code = 0);
 		/// Creates an exception.
 
@@ -46,7 +57,16 @@ public:
 		/// of the nested exception.
 
 	Exception(const Exception& exc);
-		/// Copy constructor.
+		/// Copy constructor.  The nested exceptions and a long
+		/// message are shared with the original, not copied.
+
+#if __cplusplus >= 201103L
+	Exception(Exception&& exc) noexcept;
+		/// Move constructor.
+
+	Exception& operator = (Exception&& exc) noexcept;
+		/// Move assignment operator.
+#endif
 
   Exception(const std::exception& exc);
 		/// Copy constructor.
@@ -55,7 +75,7 @@ public:
 		/// Copy constructor.
 		
 	~Exception() throw();
-		/// Destroys the exception and deletes the nested exception.
+		/// Destroys the exception and releases the nested exception.
 
 	Exception& operator = (const Exception& exc);
 		/// Assignment operator.
@@ -103,38 +123,139 @@ public:
 		/// copy of an exception (see clone()), then
 		/// throwing it again.
 
+	std::size_t stackDepth() const;
+		/// Returns the number of return addresses captured when the
+		/// exception was created, 0 if stack capture was disabled.
+
+	void* const* stackFrames() const;
+		/// Returns the captured return addresses, innermost first.
+
+	std::string stackAddresses() const;
+		/// Returns the captured stack as a space separated list of
+		/// module+offset entries, e.g. /usr/lib/libswarm_common.so+0x1a2b0.
+		/// Nothing is symbolized, so the list is cheap to log and can be
+		/// resolved offline with addr2line.
+
+	std::string stackTrace() const;
+		/// Returns the captured stack symbolized and demangled, one
+		/// frame per line.  Symbolization only happens here, so it is
+		/// not paid by exceptions that are caught and discarded.
+
+	static void enableStackCapture(bool enable);
+		/// Capture the return addresses of the stack in every exception
+		/// created from now on.  Capture walks the frames into a fixed
+		/// array inside the exception without allocating.
+		/// Default:  disabled
+
+	static bool isStackCaptureEnabled();
+		/// Returns true if exceptions capture the stack.
+
+	static ExceptionCounter& counter();
+		/// Returns the counter of the class.  See ExceptionStats.
+
 protected:
 	Exception(int code = 0);
 		/// Standard constructor.
+
+	void setCounter(ExceptionCounter& counter);
+		/// Count the exception with the counter of the class being
+		/// constructed when it ends.  Each constructor overrides the
+		/// counter of its base class.
 		
 private:
-	std::string _msg;
-	Exception*  _pNested;
+	struct Data;
+
+	void setMessage(const std::string& msg);
+	void release();
+	void captureStack();
+
+	std::string _msg;    /// Message short enough for the string's inline buffer
+	Data*       _pData;  /// Long message and nested exception shared by copies
+	ExceptionCounter* _pCounter; /// Counter of the class, null if not counted
 	int			_code;
+	unsigned int _stackDepth;
+	void*       _stack[MAX_STACK_DEPTH];
+
+	static bool _captureStack;
 };
 
 
 //
 // inlines
 //
-inline const Exception* Exception::nested() const
+inline int Exception::code() const
+{
+	return _code;
+}
+
+
+inline std::size_t Exception::stackDepth() const
 {
-	return _pNested;
+	return _stackDepth;
 }
 
 
-inline const std::string& Exception::message() const
+inline void* const* Exception::stackFrames() const
 {
-	return _msg;
+	return _stack;
 }
 
 
-inline int Exception::code() const
+inline bool Exception::isStackCaptureEnabled()
 {
-	return _code;
+	return _captureStack;
 }
 
 
+inline void Exception::setCounter(ExceptionCounter& counter)
+{
+	_pCounter = &counter;
+}
+
+
+//
+// Move operations for the exception classes declared below.  Empty
+// before C++11.
+//
+#if __cplusplus >= 201103L
+#define SWARM_DECLARE_EXCEPTION_MOVE(CLS) \
+	CLS(CLS&& exc) noexcept; \
+	CLS& operator = (CLS&& exc) noexcept;
+
+#define SWARM_IMPLEMENT_EXCEPTION_MOVE(CLS, BASE) \
+	CLS::CLS(CLS&& exc) noexcept: BASE(std::move(exc)) \
+	{ \
+	} \
+	CLS& CLS::operator = (CLS&& exc) noexcept \
+	{ \
+		BASE::operator = (std::move(exc)); \
+		return *this; \
+	}
+
+#define SWARM_INLINE_EXCEPTION_MOVE(CLS, BASE) \
+	inline CLS::CLS(CLS&& exc) noexcept: BASE(std::move(exc)) \
+	{ \
+	} \
+	inline CLS& CLS::operator = (CLS&& exc) noexcept \
+	{ \
+		BASE::operator = (std::move(exc)); \
+		return *this; \
+	}
+#else
+#define SWARM_DECLARE_EXCEPTION_MOVE(CLS)
+#define SWARM_IMPLEMENT_EXCEPTION_MOVE(CLS, BASE)
+#define SWARM_INLINE_EXCEPTION_MOVE(CLS, BASE)
+#endif
+
+
+//
+// Counts an exception with the counter of the class being constructed
+//
+#define SWARM_COUNT_EXCEPTION(CLS) \
+	if (swarm::ExceptionStats::isEnabled()) \
+		setCounter(CLS::counter());
+
+
 //
 // Macros for quickly declaring and implementing exception classes.
 // Unfortunately, we cannot use a template here because character
@@ -150,31 +271,38 @@ inline int Exception::code() const
 		CLS(const std::string& msg, const std::string& arg, int code = 0);			\
 		CLS(const std::string& msg, const swarm::Exception& exc, int code = 0);		\
 		CLS(const CLS& exc);														\
+		SWARM_DECLARE_EXCEPTION_MOVE(CLS)											\
 		~CLS() throw();																\
 		CLS& operator = (const CLS& exc);											\
 		const char* name() const throw();											\
 		const char* className() const throw();										\
 		swarm::Exception* clone() const;												\
 		void rethrow() const;														\
+		static swarm::ExceptionCounter& counter();									\
 	};
 
 
 #define SWARM_IMPLEMENT_EXCEPTION(CLS, BASE, NAME)	\
 	CLS::CLS(int code): BASE(code)		\
 	{					\
+		SWARM_COUNT_EXCEPTION(CLS)	\
 	}					\
 	CLS::CLS(const std::string& msg, int code): BASE(msg, code)	\
 	{					\
+		SWARM_COUNT_EXCEPTION(CLS)	\
 	}					\
 	CLS::CLS(const std::string& msg, const std::string& arg, int code): BASE(msg, arg, code)		\
 	{					\
+		SWARM_COUNT_EXCEPTION(CLS)	\
 	}					\
 	CLS::CLS(const std::string& msg, const swarm::Exception& exc, int code): BASE(msg, exc, code)	\
 	{					\
+		SWARM_COUNT_EXCEPTION(CLS)	\
 	}					\
 	CLS::CLS(const CLS& exc): BASE(exc)	\
 	{					\
 	}					\
+	SWARM_IMPLEMENT_EXCEPTION_MOVE(CLS, BASE)	\
 	CLS::~CLS() throw()			\
 	{					\
 	}					\
@@ -198,6 +326,11 @@ inline int Exception::code() const
 	void CLS::rethrow() const \
 	{			\
 		throw *this;	\
+	}			\
+	swarm::ExceptionCounter& CLS::counter() \
+	{			\
+		static swarm::ExceptionCounter counter(NAME, typeid(CLS).name()); \
+		return counter;	\
 	}
 
 
@@ -209,28 +342,35 @@ inline int Exception::code() const
 		CLS(const std::string& msg, const std::string& arg, int code = 0); \
 		CLS(const std::string& msg, const swarm::Exception& exc, int code = 0); \
 		CLS(const CLS& exc); \
+		SWARM_DECLARE_EXCEPTION_MOVE(CLS) \
 		~CLS() throw();																\
 		CLS& operator = (const CLS& exc); \
 		const char* name() const throw(); \
 		const char* className() const throw();	\
 		swarm::Exception* clone() const;	\
 		void rethrow() const; \
+		static swarm::ExceptionCounter& counter(); \
 	}; \
         inline CLS::CLS(int code): BASE(code)		\
 	{		                    \
+		SWARM_COUNT_EXCEPTION(CLS)			\
 	}			            \
 	inline CLS::CLS(const std::string& msg, int code): BASE(msg, code) \
 	{			\
+		SWARM_COUNT_EXCEPTION(CLS)			\
 	}			\
 	inline CLS::CLS(const std::string& msg, const std::string& arg, int code): BASE(msg, arg, code)		\
 	{ \
+		SWARM_COUNT_EXCEPTION(CLS)			\
 	}  \
 	inline CLS::CLS(const std::string& msg, const swarm::Exception& exc, int code): BASE(msg, exc, code)	\
 	{	\
+		SWARM_COUNT_EXCEPTION(CLS)			\
 	}       \
 	inline CLS::CLS(const CLS& exc): BASE(exc)	\
 	{						\
 	}						\
+	SWARM_INLINE_EXCEPTION_MOVE(CLS, BASE)		\
 	inline CLS::~CLS() throw()			\
 	{						\
 	}						\
@@ -254,6 +394,11 @@ inline int Exception::code() const
 	inline void CLS::rethrow() const				\
 	{								\
 		throw *this;						\
+	}								\
+	inline swarm::ExceptionCounter& CLS::counter()			\
+	{								\
+		static swarm::ExceptionCounter counter(NAME, typeid(CLS).name()); \
+		return counter;						\
 	}
 
 
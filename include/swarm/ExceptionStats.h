@@ -0,0 +1,171 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_EXCEPTIONSTATS_H_INCLUDED
+#define	SWARM_EXCEPTIONSTATS_H_INCLUDED
+
+
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+
+
+namespace swarm
+{
+  class Exception;
+  
+  class ExceptionCounter : boost::noncopyable
+  {
+  public:
+    ExceptionCounter(const char* name, const char* className);
+    ///
+    /// Creates the counter of an exception class and registers it with
+    /// ExceptionStats.  Counters are created by the exception classes.
+    ///
+    
+    const char* name() const;
+    ///
+    /// Returns the name() of the exception class
+    ///
+    
+    const char* className() const;
+    ///
+    /// Returns the className() of the exception class
+    ///
+    
+    unsigned long long count() const;
+    ///
+    /// Returns the number of exceptions of the class counted so far
+    ///
+    
+    void record(const Exception& exc);
+    ///
+    /// Count an exception of the class and hand it to the log hook if
+    /// none of the class was logged during the current second
+    ///
+    
+  private:
+    friend class ExceptionStats;
+    
+    const char* _name;
+    const char* _className;
+    boost::atomic<unsigned long long> _count; /// Exceptions counted
+    boost::atomic<long> _loggedSecond; /// Epoch second of the last log hook call
+    unsigned long long _listedCount; /// _count at the last ExceptionStats::list()
+    unsigned long long _listedTime; /// Clock ticks at the last ExceptionStats::list()
+    ExceptionCounter* _pNext; /// Next registered counter
+  };
+  
+  class ExceptionStats
+  {
+  public:
+    struct Entry
+    {
+      const char* name; /// name() of the exception class
+      const char* className; /// className() of the exception class
+      unsigned long long count; /// Exceptions counted since the process started
+      double rate; /// Exceptions per second since the previous list()
+    };
+    
+    typedef std::vector<Entry> Entries;
+    typedef boost::function<void(const std::string&)> LogHook;
+    typedef unsigned long LogHookId;
+    
+    class LogGuard : boost::noncopyable
+    {
+    public:
+      LogGuard();
+      ///
+      /// Exceptions that end on this thread while the guard exists are
+      /// counted but not logged, e.g. inside the logger itself
+      ///
+      
+      ~LogGuard();
+    };
+    
+    static void enable(bool enable);
+    ///
+    /// Count every swarm::Exception created from now on by class.  An
+    /// exception is counted once, when it ends, however many times it
+    /// was copied or rethrown.  Counting is a relaxed atomic increment.
+    /// Default:  disabled
+    ///
+    
+    static bool isEnabled();
+    ///
+    /// Returns true if exceptions are counted
+    ///
+    
+    static LogHookId setLogHook(const LogHook& hook);
+    ///
+    /// Call the hook with the displayText() and the count of at most one
+    /// exception per class and second.  Replaces the previous hook.
+    /// Returns the id to pass to clearLogHook().
+    ///
+    
+    static bool clearLogHook(LogHookId id);
+    ///
+    /// Remove the hook if it is still the given one and wait for the calls
+    /// to it still running on other threads.  Returns false if another
+    /// hook replaced it.  Once it returns the hook is no longer called,
+    /// so the objects it uses may be destroyed.
+    ///
+    
+    static void list(Entries& entries);
+    ///
+    /// Returns the counters of the exception classes counted so far,
+    /// with their rate since the previous call
+    ///
+    
+  private:
+    friend class ExceptionCounter;
+    
+    static bool _enabled;
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline const char* ExceptionCounter::name() const
+  {
+    return _name;
+  }
+  
+  inline const char* ExceptionCounter::className() const
+  {
+    return _className;
+  }
+  
+  inline unsigned long long ExceptionCounter::count() const
+  {
+    return _count.load(boost::memory_order_relaxed);
+  }
+  
+  inline bool ExceptionStats::isEnabled()
+  {
+    return _enabled;
+  }
+  
+} // swarm
+
+
+#endif	// SWARM_EXCEPTIONSTATS_H_INCLUDED
+
@@ -0,0 +1,124 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_FLIGHTRECORDER_H_INCLUDED
+#define	SWARM_FLIGHTRECORDER_H_INCLUDED
+
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+
+#include "swarm/Clock.h"
+#include "swarm/MappedBuffer.h"
+
+
+namespace swarm
+{
+  class FlightRecorder : public boost::noncopyable
+  {
+  public:
+    enum
+    {
+      RECORD_SIZE = 256 /// Size of a ring slot including its header
+    };
+    
+    struct Record
+    {
+      Clock::Ticks ticks; /// Time the record was captured
+      int priority; /// Priority of the record
+      std::string text; /// Captured text, truncated to the slot size
+    };
+    
+    typedef std::vector<Record> Records;
+    
+    FlightRecorder(std::size_t capacity, bool hugePages = false);
+    ///
+    /// Creates a ring that keeps the last capacity records.  If hugePages
+    /// is true the ring is backed by huge pages when available (see
+    /// swarm::MappedBuffer).
+    ///
+    
+    ~FlightRecorder();
+    ///
+    /// Destroys the ring
+    ///
+    
+    void capture(int priority, const char* text, std::size_t length);
+    ///
+    /// Copy a record into the ring.  This is lock-free and never
+    /// allocates.  Text that does not fit in a slot is truncated.
+    /// The record is dropped if a writer a full ring ahead or behind
+    /// holds the same slot.
+    ///
+    
+    void drain(Records& records);
+    ///
+    /// Append the records captured since the last drain, oldest first,
+    /// and mark them as drained.  The drain stops at the first record
+    /// still being written, which the next drain picks up.  Only one
+    /// thread may drain at a time.
+    ///
+    
+    std::size_t capacity() const;
+    ///
+    /// Returns the number of records kept by the ring
+    ///
+    
+    const MappedBuffer& buffer() const;
+    ///
+    /// Returns the memory backing the ring
+    ///
+    
+  private:
+    struct Slot
+    {
+      boost::atomic<unsigned long long> sequence; /// Even when stable, odd while being written
+      boost::atomic<unsigned long long> dropped; /// One past the highest position dropped at the slot
+      Clock::Ticks ticks;
+      int priority;
+      unsigned int length;
+      char text[RECORD_SIZE - 2 * sizeof(boost::atomic<unsigned long long>) - sizeof(Clock::Ticks) - 2 * sizeof(int)];
+    };
+    
+    MappedBuffer _buffer; /// The ring storage
+    Slot* _pSlots; /// The slots in _buffer
+    std::size_t _capacity; /// Number of slots in the ring
+    boost::atomic<unsigned long long> _head; /// Position of the next record to be written
+    unsigned long long _drained; /// Position of the first record not yet drained
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline std::size_t FlightRecorder::capacity() const
+  {
+    return _capacity;
+  }
+  
+  inline const MappedBuffer& FlightRecorder::buffer() const
+  {
+    return _buffer;
+  }
+
+} // swarm
+
+
+#endif	// SWARM_FLIGHTRECORDER_H_INCLUDED
@@ -0,0 +1,152 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_LOGCALLSITE_H_INCLUDED
+#define	SWARM_LOGCALLSITE_H_INCLUDED
+
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+
+
+namespace swarm
+{
+  class LogCallSite : public boost::noncopyable
+  {
+  public:
+    enum State
+    {
+      STATE_DEFAULT,  /// Follow the logger priority level
+      STATE_ENABLED,  /// Always log, regardless of the logger priority level
+      STATE_DISABLED  /// Never log
+    };
+    
+    typedef std::vector<const LogCallSite*> Sites;
+    
+    LogCallSite(const char* file, int line, const char* function, int priority);
+    ///
+    /// Registers a call site in the process-wide table.  Call sites are
+    /// created as function-local statics by the SWARM_LOG_* macros and
+    /// live for the duration of the process.
+    ///
+    
+    ~LogCallSite();
+    ///
+    /// Removes the call site from the table, e.g. when the library
+    /// holding it is unloaded
+    ///
+    
+    const char* file() const;
+    ///
+    /// Returns the source file of the call site
+    ///
+    
+    int line() const;
+    ///
+    /// Returns the source line of the call site
+    ///
+    
+    const char* function() const;
+    ///
+    /// Returns the function enclosing the call site
+    ///
+    
+    int priority() const;
+    ///
+    /// Returns the priority of the call site
+    ///
+    
+    State getState() const;
+    ///
+    /// Returns the current state of the call site
+    ///
+    
+    static std::size_t setState(const std::string& pattern, State state);
+    ///
+    /// Set the state of every call site matching the glob pattern.
+    /// The pattern is matched against "file:line" (with the full path
+    /// and with the file name only) and against the function name.
+    /// The rule is remembered and applied to call sites registered later.
+    /// It replaces an earlier rule with the same pattern.
+    /// Returns the number of registered call sites that matched.
+    ///
+    
+    static void resetState();
+    ///
+    /// Forget all rules and put every call site back in STATE_DEFAULT
+    ///
+    
+    static bool loadControlFile(const std::string& path);
+    ///
+    /// Replace the current rules with the ones in the control file.
+    /// Each line holds a glob pattern followed by on, off or default.
+    /// Empty lines and lines starting with # are ignored.
+    /// Returns false if the file cannot be read.
+    ///
+    
+    static void getSites(Sites& sites);
+    ///
+    /// Returns all the registered call sites.  A site is only valid
+    /// while the library holding it stays loaded.
+    ///
+    
+  private:
+    bool matches(const std::string& pattern) const;
+    
+    const char* _file; /// Source file
+    int _line; /// Source line
+    const char* _function; /// Enclosing function
+    int _priority; /// Priority of the call site
+    boost::atomic<int> _state; /// Current State
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline const char* LogCallSite::file() const
+  {
+    return _file;
+  }
+  
+  inline int LogCallSite::line() const
+  {
+    return _line;
+  }
+  
+  inline const char* LogCallSite::function() const
+  {
+    return _function;
+  }
+  
+  inline int LogCallSite::priority() const
+  {
+    return _priority;
+  }
+  
+  inline LogCallSite::State LogCallSite::getState() const
+  {
+    return (State)_state.load(boost::memory_order_relaxed);
+  }
+
+} // swarm
+
+
+#endif	// SWARM_LOGCALLSITE_H_INCLUDED
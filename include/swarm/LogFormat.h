@@ -0,0 +1,215 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_LOGFORMAT_H_INCLUDED
+#define	SWARM_LOGFORMAT_H_INCLUDED
+
+
+#include <string>
+#include <sstream>
+
+
+namespace swarm
+{
+  class LogFormat
+  {
+  public:
+    //
+    // Append a single value to a record buffer.  Integers, floating
+    // point values, strings and pointers are written directly into the
+    // buffer.  Any other type goes through its operator<<.
+    //
+    static void append(std::string& out, bool value);
+    static void append(std::string& out, char value);
+    static void append(std::string& out, signed char value);
+    static void append(std::string& out, unsigned char value);
+    static void append(std::string& out, short value);
+    static void append(std::string& out, unsigned short value);
+    static void append(std::string& out, int value);
+    static void append(std::string& out, unsigned int value);
+    static void append(std::string& out, long value);
+    static void append(std::string& out, unsigned long value);
+    static void append(std::string& out, long long value);
+    static void append(std::string& out, unsigned long long value);
+    static void append(std::string& out, float value);
+    static void append(std::string& out, double value);
+    static void append(std::string& out, const char* value);
+    static void append(std::string& out, char* value);
+    static void append(std::string& out, const std::string& value);
+    static void append(std::string& out, const void* value);
+    
+    template <typename T>
+    static void append(std::string& out, T* value);
+    
+    template <typename T>
+    static void append(std::string& out, const T& value);
+    
+    static bool appendLiteral(std::string& out, const char*& format);
+    ///
+    /// Append the text of format up to the next {} placeholder and move
+    /// format past it.  {{ and }} are written as { and }.  Returns false
+    /// when the end of format is reached without finding a placeholder.
+    ///
+    
+#if __cplusplus >= 201103L
+    template <typename T, typename... Args>
+    static void format(std::string& out, const char* format, const T& value, const Args&... args);
+    ///
+    /// Render format into out, replacing each {} with the next argument.
+    /// Placeholders without an argument are written as is and arguments
+    /// without a placeholder are ignored.
+    ///
+    
+    static void format(std::string& out, const char* format);
+    ///
+    /// Render the remainder of a format without arguments
+    ///
+    
+    template <std::size_t N>
+    static constexpr std::size_t placeholders(const char (&format)[N]);
+    ///
+    /// Count the {} placeholders of a format literal at compile time.
+    /// Returns INVALID if the format has an unmatched { or }.  The
+    /// format is split in halves between brace runs, so the recursion
+    /// depth grows with the logarithm of its length.
+    ///
+    
+    template <typename... Args>
+    static char (&countArgs(const Args&...))[sizeof...(Args) + 1];
+    ///
+    /// Never defined.  sizeof(countArgs(args...)) - 1 is the number of
+    /// arguments, usable from a macro without evaluating them.
+    ///
+    
+    static constexpr std::size_t INVALID = ~(std::size_t)0;
+    
+  private:
+    static constexpr bool isBrace(char c);
+    
+    static constexpr std::size_t find(const char* format, std::size_t begin, std::size_t end, bool brace);
+    ///
+    /// Index of the first character in [begin, end) that is a brace, or
+    /// not a brace, end if there is none
+    ///
+    
+    static constexpr std::size_t firstOf(std::size_t found, std::size_t middle, const char* format, std::size_t end, bool brace);
+    
+    static constexpr std::size_t countRange(const char* format, std::size_t begin, std::size_t end);
+    ///
+    /// Count the placeholders in [begin, end).  Neither end may be inside
+    /// a run of braces.
+    ///
+    
+    static constexpr std::size_t countSplit(const char* format, std::size_t begin, std::size_t split, std::size_t end);
+    
+    static constexpr std::size_t countScan(const char* format, std::size_t position, std::size_t end, std::size_t count);
+    
+    static constexpr std::size_t add(std::size_t left, std::size_t right);
+#endif
+  };
+  
+  //
+  // Inlines
+  //
+  
+  template <typename T>
+  inline void LogFormat::append(std::string& out, T* value)
+  {
+    append(out, static_cast<const void*>(value));
+  }
+  
+  template <typename T>
+  inline void LogFormat::append(std::string& out, const T& value)
+  {
+    std::ostringstream strm;
+    strm << value;
+    out += strm.str();
+  }
+  
+#if __cplusplus >= 201103L
+  template <typename T, typename... Args>
+  inline void LogFormat::format(std::string& out, const char* format, const T& value, const Args&... args)
+  {
+    if (appendLiteral(out, format))
+      append(out, value);
+    LogFormat::format(out, format, args...);
+  }
+  
+  inline void LogFormat::format(std::string& out, const char* format)
+  {
+    while (appendLiteral(out, format))
+      out.append("{}", 2);
+  }
+  
+  template <std::size_t N>
+  inline constexpr std::size_t LogFormat::placeholders(const char (&format)[N])
+  {
+    return countRange(format, 0, N - 1);
+  }
+  
+  inline constexpr bool LogFormat::isBrace(char c)
+  {
+    return c == '{' || c == '}';
+  }
+  
+  inline constexpr std::size_t LogFormat::find(const char* format, std::size_t begin, std::size_t end, bool brace)
+  {
+    return end - begin <= 1 ? (begin < end && isBrace(format[begin]) == brace ? begin : end) :
+      firstOf(find(format, begin, begin + (end - begin) / 2, brace), begin + (end - begin) / 2, format, end, brace);
+  }
+  
+  inline constexpr std::size_t LogFormat::firstOf(std::size_t found, std::size_t middle, const char* format, std::size_t end, bool brace)
+  {
+    return found != middle ? found : find(format, middle, end, brace);
+  }
+  
+  inline constexpr std::size_t LogFormat::countRange(const char* format, std::size_t begin, std::size_t end)
+  {
+    //
+    // Split after the first character at or past the middle that is not
+    // a brace, so both halves start outside a run of braces
+    //
+    return end - begin <= 16 ? countScan(format, begin, end, 0) :
+      countSplit(format, begin, find(format, begin + (end - begin) / 2, end, false) + 1, end);
+  }
+  
+  inline constexpr std::size_t LogFormat::countSplit(const char* format, std::size_t begin, std::size_t split, std::size_t end)
+  {
+    return split >= end ? countScan(format, begin, end, 0) :
+      add(countRange(format, begin, split), countRange(format, split, end));
+  }
+  
+  inline constexpr std::size_t LogFormat::countScan(const char* format, std::size_t position, std::size_t end, std::size_t count)
+  {
+    return position >= end ? count :
+      (format[position] == '{' && format[position + 1] == '{') || (format[position] == '}' && format[position + 1] == '}') ? countScan(format, position + 2, end, count) :
+      (format[position] == '{' && format[position + 1] == '}') ? countScan(format, position + 2, end, count + 1) :
+      isBrace(format[position]) ? INVALID :
+      countScan(format, position + 1, end, count);
+  }
+  
+  inline constexpr std::size_t LogFormat::add(std::size_t left, std::size_t right)
+  {
+    return left == INVALID || right == INVALID ? INVALID : left + right;
+  }
+#endif
+
+} // swarm
+
+
+#endif	// SWARM_LOGFORMAT_H_INCLUDED
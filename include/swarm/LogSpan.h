@@ -0,0 +1,105 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_LOGSPAN_H_INCLUDED
+#define	SWARM_LOGSPAN_H_INCLUDED
+
+
+#include <boost/noncopyable.hpp>
+
+#include "swarm/Logger.h"
+#include "swarm/Clock.h"
+
+
+namespace swarm
+{
+  class LogSpan : public boost::noncopyable
+  {
+  public:
+    LogSpan(
+      const char* name, // static name of the span
+      Logger::Priority priority = Logger::PRIO_DEBUG, // priority of the emitted record
+      unsigned long threshold = 0, // slow span threshold in microseconds.  0 disables it
+      Logger* pLogger = Logger::instance() // logger that will receive the record
+    );
+    ///
+    /// Start timing a scope using swarm::Clock ticks.  If neither the
+    /// priority is enabled nor a threshold is set, the span does not
+    /// read the clock at all.
+    ///
+    
+    ~LogSpan();
+    ///
+    /// Stop timing the scope and emit a single record with the duration.
+    /// The record is written at the span priority if it is enabled.
+    /// If the duration reached the threshold, the record is written
+    /// as a warning instead, regardless of the span priority.
+    ///
+    
+    unsigned long long elapsed() const;
+    ///
+    /// Returns the time spent in the span so far in nanoseconds.
+    /// Returns 0 if the span is not being timed.
+    ///
+    
+  private:
+    const char* _name; /// Static name of the span
+    Logger* _pLogger; /// The logger receiving the record
+    Logger::Priority _priority; /// Priority of the emitted record
+    unsigned long long _threshold; /// Slow span threshold in nanoseconds
+    Clock::Ticks _start; /// Clock ticks on entry
+    bool _enabled; /// True if the span priority was enabled on entry
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline LogSpan::LogSpan(const char* name, Logger::Priority priority, unsigned long threshold, Logger* pLogger) :
+    _name(name),
+    _pLogger(pLogger),
+    _priority(priority),
+    _threshold((unsigned long long)threshold * 1000),
+    _start(0),
+    _enabled(pLogger->willLog(priority))
+  {
+    if (_enabled || _threshold)
+      _start = Clock::ticks();
+  }
+  
+  inline unsigned long long LogSpan::elapsed() const
+  {
+    return _start ? Clock::nanoseconds(Clock::ticks() - _start) : 0;
+  }
+
+} // swarm
+
+//
+// Convenience Macros
+//
+
+#define SWARM_LOG_SPAN_CONCAT_(a, b) a##b
+#define SWARM_LOG_SPAN_CONCAT(a, b) SWARM_LOG_SPAN_CONCAT_(a, b)
+
+#define SWARM_LOG_SPAN(name) \
+  swarm::LogSpan SWARM_LOG_SPAN_CONCAT(swarm_log_span_, __LINE__)(name)
+
+#define SWARM_LOG_SPAN_THRESHOLD(name, microseconds) \
+  swarm::LogSpan SWARM_LOG_SPAN_CONCAT(swarm_log_span_, __LINE__)(name, swarm::Logger::PRIO_DEBUG, microseconds)
+
+#endif	// SWARM_LOGSPAN_H_INCLUDED
@@ -21,14 +21,28 @@
 
 
 #include <ctime>
+#include <exception>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
 #include <boost/thread.hpp>
+#include <boost/utility/string_ref.hpp>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "swarm/ExceptionStats.h"
+#include "swarm/LogCallSite.h"
+#include "swarm/LogFormat.h"
+#include "swarm/ThreadOptions.h"
 
 
 namespace swarm
 {
+  class FlightRecorder;
+  
   class Logger : public boost::noncopyable
   {
   public:
@@ -36,6 +50,19 @@ namespace swarm
     typedef boost::mutex mutex;
     typedef boost::lock_guard<mutex> mutex_lock;
     
+    enum SinkMode
+    {
+      SINK_FILE,  /// Poco::FileChannel.  Supports rotation
+      SINK_APPEND /// swarm::AppendChannel.  Atomic records for files shared by processes
+    };
+    
+    struct Stats
+    {
+      std::size_t bufferBytes; /// Memory mapped for the logger buffers
+      std::size_t hugePageBytes; /// Part of bufferBytes taken from the hugetlb pool
+      std::size_t transparentHugePageBytes; /// Part of bufferBytes advised for transparent huge pages
+    };
+    
     enum Priority
     {
       PRIO_FATAL = 1,   /// A fatal error. The application will most likely terminate. This is the highest priority.
@@ -47,6 +74,9 @@ namespace swarm
       PRIO_DEBUG,       /// A debugging message.
       PRIO_TRACE        /// A tracing message. This is the lowest priority.
     };
+    
+    typedef boost::function<void(Priority, const char*, std::size_t)> Subscriber;
+    typedef unsigned int SubscriptionId;
 
     Logger(const std::string& name);
     ///
@@ -98,6 +128,21 @@ namespace swarm
     /// If error is encountered, getLastError()should return the error string
     ///
     
+    bool reload(
+      const std::string& path,  // path for the log file 
+      Priority priority, // Log priority level
+      const std::string& format, // format for the log headers
+      unsigned int purgeCount // number of files to maintain during log rotation
+    );
+    ///
+    /// Reconfigure an open or closed logger.  The new channel is built
+    /// without holding the logger lock and swapped in atomically, so
+    /// logging threads never wait for the rebuild.  Every message goes
+    /// either to the old or to the new channel.  On error the current
+    /// channel is kept, false is returned and getLastError() should
+    /// return the error string.  An empty format selects the default.
+    ///
+    
     const std::string& getName() const;
     ///
     /// Returns the logger name specified in constructor
@@ -129,50 +174,197 @@ namespace swarm
     ///
     
     void fatal(const std::string& log);
+    void fatal(const char* log);
+    void fatal(boost::string_ref log);
     ///
     /// Log a message in fatal level 
     ///
     
     void critical(const std::string& log);
+    void critical(const char* log);
+    void critical(boost::string_ref log);
     ///
     /// Log a message in critical level 
     ///
     
     void error(const std::string& log);
+    void error(const char* log);
+    void error(boost::string_ref log);
     ///
     /// Log a message in error level 
     ///
     
     void warning(const std::string& log);
+    void warning(const char* log);
+    void warning(boost::string_ref log);
     ///
     /// Log a message in warning level 
     ///
     
     void notice(const std::string& log);
+    void notice(const char* log);
+    void notice(boost::string_ref log);
     ///
     /// Log a message in notice level 
     ///
     
     void information(const std::string& log);
+    void information(const char* log);
+    void information(boost::string_ref log);
     ///
     /// Log a message in info level 
     ///
     
     void debug(const std::string& log);
+    void debug(const char* log);
+    void debug(boost::string_ref log);
     ///
     /// Log a message in debug level 
     ///
     
     void trace(const std::string& log);
+    void trace(const char* log);
+    void trace(boost::string_ref log);
     ///
     /// Log a message in trace level 
     ///
     
+    void log(Priority priority, const std::string& log);
+    void log(Priority priority, const char* log);
+    void log(Priority priority, boost::string_ref log);
+    ///
+    /// Log a message in the given priority level.  The text is copied
+    /// straight into buffers owned by the logger that are reused from
+    /// one record to the next, so none of these overloads allocate once
+    /// the buffers have grown to the size of the longest record.
+    /// Use boost::string_ref(data, length) to log a buffer that is not
+    /// null terminated.
+    ///
+    
+#if __cplusplus >= 201703L
+    void fatal(std::string_view log);
+    void critical(std::string_view log);
+    void error(std::string_view log);
+    void warning(std::string_view log);
+    void notice(std::string_view log);
+    void information(std::string_view log);
+    void debug(std::string_view log);
+    void trace(std::string_view log);
+    void log(Priority priority, std::string_view log);
+    ///
+    /// std::string_view overloads of the above
+    ///
+#endif
+    
     bool willLog(Priority priority) const;
     ///
     /// Return true if priority is >= _priority
     ///
     
+    bool willLog(const LogCallSite& site) const;
+    ///
+    /// Return true if a message from the call site would be logged
+    /// or captured by the flight recorder.  Used by the SWARM_LOG_*
+    /// macros to skip formatting messages that would be discarded.
+    ///
+    
+    void log(const LogCallSite& site, const std::string& log);
+    ///
+    /// Log a message from a call site.  Messages from call sites in
+    /// LogCallSite::STATE_ENABLED are written regardless of the
+    /// priority level and STATE_DISABLED call sites are dropped.
+    ///
+    
+    void log(Priority priority, const std::exception& exc);
+    ///
+    /// Log an exception in the given priority level.  See formatException()
+    ///
+    
+    void log(const LogCallSite& site, const std::exception& exc);
+    ///
+    /// Log an exception from a call site.  Used by SWARM_LOG_EXCEPTION.
+    ///
+    
+    static void formatException(std::string& out, const std::exception& exc);
+    ///
+    /// Append an exception to out.  A swarm::Exception is rendered as
+    /// name: message [code N] followed by its nested exceptions, each
+    /// introduced by ", caused by ".  Other exceptions are rendered as
+    /// what().  Nothing is allocated if out has the capacity.
+    ///
+    
+#if __cplusplus >= 201103L
+    template <typename A, typename... Args>
+    void log(Priority priority, const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in the given priority level.  Each {} in
+    /// format is replaced by the next argument (see swarm::LogFormat).
+    /// The message is only rendered if it is going to be logged, into a
+    /// per-thread buffer that is reused from one call to the next.
+    ///
+    
+    template <typename A, typename... Args>
+    void log(const LogCallSite& site, const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message from a call site
+    ///
+    
+    template <typename A, typename... Args>
+    void fatal(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in fatal level 
+    ///
+    
+    template <typename A, typename... Args>
+    void critical(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in critical level 
+    ///
+    
+    template <typename A, typename... Args>
+    void error(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in error level 
+    ///
+    
+    template <typename A, typename... Args>
+    void warning(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in warning level 
+    ///
+    
+    template <typename A, typename... Args>
+    void notice(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in notice level 
+    ///
+    
+    template <typename A, typename... Args>
+    void information(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in info level 
+    ///
+    
+    template <typename A, typename... Args>
+    void debug(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in debug level 
+    ///
+    
+    template <typename A, typename... Args>
+    void trace(const char* format, const A& arg, const Args&... args);
+    ///
+    /// Log a formatted message in trace level 
+    ///
+#endif
+    
+    static Priority parsePriority(const std::string& priority, Priority defaultPriority);
+    ///
+    /// Convert a priority name (fatal, critical, error, warning, notice,
+    /// information, debug, trace) or number to a Priority.  Returns
+    /// defaultPriority if the string cannot be converted.
+    ///
+    
     static Logger* instance();
     ///
     /// Returns the default logger instance.
@@ -203,9 +395,179 @@ namespace swarm
     void setVerificationInterval(unsigned int seconds);
     ///
     /// Set the verification interval.  This is expressed un seconds.
+    /// Values below 1 second are raised to 1 second.
     /// Default:  5 seconds
     ///
     
+    void enableFlightRecorder(std::size_t records, Priority priority = PRIO_TRACE);
+    ///
+    /// Keep the last records that are suppressed by the current priority
+    /// level, down to the given priority, in a fixed-size in-memory ring.
+    /// Capturing a record is lock-free and does not touch the disk.
+    /// The ring is written to the log ahead of every error, critical and
+    /// fatal record, or on demand by calling dumpFlightRecorder().
+    /// This must be called once, before other threads use the logger.
+    /// Default:  disabled
+    ///
+    
+    void dumpFlightRecorder();
+    ///
+    /// Write the records held by the flight recorder to the log
+    ///
+    
+    void enableHugePages(bool enable);
+    ///
+    /// Back the buffers allocated afterwards, such as the flight recorder
+    /// ring, with 2 MB huge pages.  Explicit huge pages are used if the
+    /// hugetlb pool has enough free pages, transparent huge pages
+    /// otherwise, and regular pages if neither is available.  Buffers
+    /// smaller than a huge page are not affected.  See getStats().
+    /// Default:  false
+    ///
+    
+    Stats getStats() const;
+    ///
+    /// Returns the memory used by the logger buffers
+    ///
+    
+    void setSinkMode(SinkMode mode);
+    ///
+    /// Select how records reach the file, applied on the next open()
+    /// or reload().  SINK_APPEND writes every record with a single
+    /// O_APPEND write() so several processes can log to the same file
+    /// without interleaving or locking.  The purge count is ignored in
+    /// that mode; rotate the file externally and let verification or
+    /// the watcher reopen it.
+    /// Default:  SINK_FILE
+    ///
+    
+    SinkMode getSinkMode() const;
+    ///
+    /// Returns the sink mode
+    ///
+    
+    static bool parseSinkMode(const std::string& mode, SinkMode& result);
+    ///
+    /// Convert a sink mode name (file or append) to a SinkMode.
+    /// Returns false if the name is unknown.
+    ///
+    
+    void enableDurability(Priority priority = PRIO_CRITICAL, unsigned int windowMicroseconds = 1000);
+    ///
+    /// Make records at the given priority and above durable before the
+    /// log call returns.  Such callers wait, after releasing the logger
+    /// lock, for a group commit fdatasync() that covers every record
+    /// written so far, shared with the other callers that arrive within
+    /// the batching window.  Lower priorities are not affected.
+    /// Requires SINK_APPEND; ignored with SINK_FILE.
+    /// Default:  disabled
+    ///
+    
+    void disableDurability();
+    ///
+    /// Stop waiting for records to reach the disk
+    ///
+    
+    void setPreallocation(std::size_t chunk);
+    ///
+    /// Reserve disk space for the log file in chunks of the given size,
+    /// e.g. 64 MB, as it grows, and release the unused tail when the file
+    /// is closed or reopened after rotation.  Assumes this logger is the
+    /// only writer of the file.  Requires SINK_APPEND and is applied on
+    /// the next open() or reload().  0 disables preallocation.
+    /// Default:  0
+    ///
+    
+    void enableDropCache(bool enable);
+    ///
+    /// Drop the written log from the page cache as it reaches the disk
+    /// so that logging does not evict the application's cached data.
+    /// Requires SINK_APPEND and is applied on the next open() or reload().
+    /// Default:  false
+    ///
+    
+    void setMaxRecordSize(std::size_t size);
+    ///
+    /// Set the size of the largest record written atomically by
+    /// SINK_APPEND.  Longer records are truncated and marked.  Applied
+    /// on the next open() or reload().
+    /// Default:  64 KB
+    ///
+    
+    SubscriptionId subscribe(const Subscriber& subscriber, Priority priority = PRIO_TRACE, unsigned int budgetMicroseconds = 0);
+    ///
+    /// Stream the written records at the given priority and above to an
+    /// in-process observer.  The subscriber is called on the writing
+    /// thread, with the logger lock held, with a view of the formatted
+    /// record in the logger's buffer, without the line terminator.  The
+    /// view is only valid during the call.  The subscriber must not log
+    /// to this logger or change its subscriptions.
+    /// The budget bounds the writer time the subscriber may take, in
+    /// microseconds per second.  Records that arrive while it is over
+    /// budget are dropped for it and counted.  0 means no limit.
+    /// Returns the id to pass to unsubscribe()
+    ///
+    
+    bool unsubscribe(SubscriptionId id);
+    ///
+    /// Stop the delivery to a subscriber.  Returns false if the id is unknown
+    ///
+    
+    unsigned long long getDroppedRecords(SubscriptionId id);
+    ///
+    /// Returns the number of records a subscriber missed because it was
+    /// over its budget
+    ///
+    
+    void enableExceptionLog(Priority priority = PRIO_WARNING);
+    ///
+    /// Count swarm::Exception instances by class and log the first
+    /// exception of each class in every second at the given priority,
+    /// together with the count so far.  See swarm::ExceptionStats.
+    /// Only one logger can log exceptions at a time.
+    ///
+    
+    void disableExceptionLog();
+    ///
+    /// Stop logging exceptions.  They are still counted.  Does nothing
+    /// if another logger enabled its exception log since.  Returns once
+    /// no thread is logging an exception through this logger.
+    ///
+    
+    bool startWatcher();
+    ///
+    /// Start a background thread that verifies the log file every
+    /// verification interval and reopens it if it was deleted.  The
+    /// write path then no longer checks the file itself.  Returns false
+    /// if the watcher is already running or the thread cannot be created.
+    ///
+    
+    void stopWatcher();
+    ///
+    /// Stop the watcher thread.  Verification moves back to the write path
+    ///
+    
+    void setThreadOptions(const ThreadOptions& options);
+    ///
+    /// Set the CPU affinity, scheduling policy and I/O priority of the
+    /// threads owned by the logger, e.g. to keep them on housekeeping
+    /// cores.  Each thread applies the options when it starts and again
+    /// whenever they change, then logs the settings it ended up with.
+    /// Default:  inherited from the thread that starts them
+    ///
+    
+    ThreadOptions getThreadOptions() const;
+    ///
+    /// Returns the options set by setThreadOptions()
+    ///
+    
+    ThreadOptions getEffectiveThreadOptions() const;
+    ///
+    /// Returns the settings in effect on the logger threads as read back
+    /// after the options were last applied.  Returns default options
+    /// if no logger thread is running.
+    ///
+    
   protected:
     void close();
     ///
@@ -223,7 +585,68 @@ namespace swarm
     /// verification interval.  This is not a thread safe call
     /// and is intended to be called within the logger internals only.
     
+    void dispatch(Priority priority, const char* log, std::size_t length);
+    ///
+    /// Write a message if the priority level allows it, otherwise hand
+    /// it to the flight recorder.  All level methods end up here.
+    ///
+    
+    void record(Priority priority, const char* log, std::size_t length);
+    ///
+    /// Capture a suppressed message in the flight recorder if enabled
+    ///
+    
+    bool willFormat(Priority priority) const;
+    ///
+    /// Return true if a message would be logged or captured by the
+    /// flight recorder
+    ///
+    
+    static std::string& formatBuffer();
+    ///
+    /// Returns the per-thread buffer formatted messages are rendered to
+    ///
+    
+    void write(Priority priority, const char* log, std::size_t length);
+    ///
+    /// Write a message bypassing the priority level
+    ///
+    
+    void flushFlightRecorder();
+    ///
+    /// Write the flight recorder records to the log.  This is not a
+    /// thread safe call and is intended to be called within the logger
+    /// internals only.
+    ///
+    
+    bool isWritable();
+    ///
+    /// Returns true if a record can be written, verifying the log file
+    /// first unless the watcher does it.  Must be called with the
+    /// logger mutex held.
+    ///
+    
+    void runWatcher();
+    ///
+    /// Body of the watcher thread
+    ///
+    
+    void applyThreadOptions(const ThreadOptions& options);
+    ///
+    /// Apply the thread options to the calling logger thread and report
+    /// the effective settings
+    ///
+
+    void logException(Priority priority, const std::string& text);
+    ///
+    /// The swarm::ExceptionStats log hook installed by enableExceptionLog()
+    ///
+
   private:
+    struct Pipeline;
+    struct Subscription;
+    typedef std::vector<Subscription*> Subscriptions;
+    
     static Logger* _pLoggerInstance; /// Pointer to the default logger instance
     std::string _name; /// The logger name 
     std::string _format; /// Log format string
@@ -237,8 +660,29 @@ namespace swarm
     bool _enableVerification; /// enable/disable verification
     unsigned int _verificationInterval; /// Expiration for verification expressed in seconds
     bool _isOpen;  /// Flag indicator if logger is open
+    Pipeline* _pPipeline;  /// The formatter, file channel and record buffers.  Null if closed
     std::string _lastError;  /// last error encountered after a logger function is invoked
     mutex _mutex;  /// Internal mutex
+    FlightRecorder* _pFlightRecorder; /// Ring of suppressed records.  Null if disabled
+    Priority _flightRecorderPriority; /// Lowest priority kept by the flight recorder
+    bool _enableHugePages; /// Back large buffers with huge pages
+    SinkMode _sinkMode; /// How records reach the file
+    std::size_t _maxRecordSize; /// Largest atomic record in SINK_APPEND mode
+    int _durablePriority; /// Records at this priority and above are synced.  0 if disabled
+    unsigned int _syncWindow; /// Group commit batching window in microseconds
+    std::size_t _preallocation; /// fallocate() chunk size in SINK_APPEND mode.  0 if disabled
+    bool _dropCache; /// Drop the written log from the page cache in SINK_APPEND mode
+    bool _watching; /// The watcher verifies the log file.  Guarded by _mutex
+    boost::thread* _pWatcher; /// The watcher thread.  Null if not running
+    mutable mutex _threadMutex; /// Guards the watcher state and thread options
+    boost::condition_variable _threadCondition; /// Wakes the watcher up
+    bool _stopWatcher; /// Tells the watcher to exit
+    ThreadOptions _threadOptions; /// Options applied by the logger threads
+    ThreadOptions _effectiveThreadOptions; /// Settings read back by the logger threads
+    unsigned int _threadOptionsVersion; /// Incremented by setThreadOptions()
+    Subscriptions _subscriptions; /// Observers of the record stream.  Guarded by _mutex
+    SubscriptionId _lastSubscriptionId; /// Id of the last subscription
+    ExceptionStats::LogHookId _exceptionLogHook; /// Hook installed by enableExceptionLog() or 0
   };
   
   //
@@ -280,6 +724,145 @@ namespace swarm
     return _lastError;
   }
   
+  inline bool Logger::willLog(const LogCallSite& site) const
+  {
+    switch (site.getState())
+    {
+      case LogCallSite::STATE_ENABLED:
+        return true;
+      case LogCallSite::STATE_DISABLED:
+        return false;
+      default:
+        return willFormat((Priority)site.priority());
+    }
+  }
+  
+  inline bool Logger::willFormat(Priority priority) const
+  {
+    return priority <= _priority || (_pFlightRecorder && priority <= _flightRecorderPriority);
+  }
+  
+#if __cplusplus >= 201703L
+  inline void Logger::fatal(std::string_view log)
+  {
+    dispatch(PRIO_FATAL, log.data(), log.size());
+  }
+  
+  inline void Logger::critical(std::string_view log)
+  {
+    dispatch(PRIO_CRITICAL, log.data(), log.size());
+  }
+  
+  inline void Logger::error(std::string_view log)
+  {
+    dispatch(PRIO_ERROR, log.data(), log.size());
+  }
+  
+  inline void Logger::warning(std::string_view log)
+  {
+    dispatch(PRIO_WARNING, log.data(), log.size());
+  }
+  
+  inline void Logger::notice(std::string_view log)
+  {
+    dispatch(PRIO_NOTICE, log.data(), log.size());
+  }
+  
+  inline void Logger::information(std::string_view log)
+  {
+    dispatch(PRIO_INFORMATION, log.data(), log.size());
+  }
+  
+  inline void Logger::debug(std::string_view log)
+  {
+    dispatch(PRIO_DEBUG, log.data(), log.size());
+  }
+  
+  inline void Logger::trace(std::string_view log)
+  {
+    dispatch(PRIO_TRACE, log.data(), log.size());
+  }
+  
+  inline void Logger::log(Priority priority, std::string_view log)
+  {
+    dispatch(priority, log.data(), log.size());
+  }
+#endif
+  
+#if __cplusplus >= 201103L
+  template <typename A, typename... Args>
+  inline void Logger::log(Priority priority, const char* format, const A& arg, const Args&... args)
+  {
+    if (!willFormat(priority))
+      return;
+    
+    std::string& buffer = formatBuffer();
+    buffer.clear();
+    LogFormat::format(buffer, format, arg, args...);
+    log(priority, buffer);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::log(const LogCallSite& site, const char* format, const A& arg, const Args&... args)
+  {
+    if (!willLog(site))
+      return;
+    
+    std::string& buffer = formatBuffer();
+    buffer.clear();
+    LogFormat::format(buffer, format, arg, args...);
+    log(site, buffer);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::fatal(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_FATAL, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::critical(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_CRITICAL, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::error(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_ERROR, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::warning(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_WARNING, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::notice(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_NOTICE, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::information(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_INFORMATION, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::debug(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_DEBUG, format, arg, args...);
+  }
+  
+  template <typename A, typename... Args>
+  inline void Logger::trace(const char* format, const A& arg, const Args&... args)
+  {
+    log(PRIO_TRACE, format, arg, args...);
+  }
+#endif
+  
   inline void Logger::enableVerification(bool enable)
   {
     _enableVerification = enable;
@@ -287,7 +870,37 @@ namespace swarm
   
   inline void Logger::setVerificationInterval(unsigned int seconds)
   {
-    _verificationInterval = seconds;
+    _verificationInterval = seconds ? seconds : 1;
+  }
+  
+  inline void Logger::enableHugePages(bool enable)
+  {
+    _enableHugePages = enable;
+  }
+  
+  inline void Logger::setSinkMode(SinkMode mode)
+  {
+    _sinkMode = mode;
+  }
+  
+  inline Logger::SinkMode Logger::getSinkMode() const
+  {
+    return _sinkMode;
+  }
+  
+  inline void Logger::setMaxRecordSize(std::size_t size)
+  {
+    _maxRecordSize = size;
+  }
+  
+  inline void Logger::setPreallocation(std::size_t chunk)
+  {
+    _preallocation = chunk;
+  }
+  
+  inline void Logger::enableDropCache(bool enable)
+  {
+    _dropCache = enable;
   }
 
 } // swarm
@@ -296,61 +909,83 @@ namespace swarm
 // Convenience Macros
 //
 
-#define SWARM_LOG_FATAL(log) \
+//
+// Every macro registers its call site once so it can be switched on or
+// off at runtime (see swarm::LogCallSite).  The message is only
+// formatted if it is going to be logged or captured.
+//
+#define SWARM_LOG_CALL_SITE(priority, msg) \
 { \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->fatal(strm.str()); \
+  static swarm::LogCallSite swarm_log_call_site(__FILE__, __LINE__, __FUNCTION__, priority); \
+  swarm::Logger* swarm_log_logger = swarm::Logger::instance(); \
+  if (swarm_log_logger->willLog(swarm_log_call_site)) \
+  { \
+    std::ostringstream strm; \
+    strm << msg; \
+    swarm_log_logger->log(swarm_log_call_site, strm.str()); \
+  } \
 }
 
-#define SWARM_LOG_CRITICAL(log) \
-{ \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->critical(strm.str()); \
-}
+#define SWARM_LOG_FATAL(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_FATAL, msg)
 
-#define SWARM_LOG_ERROR(log) \
-{ \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->error(strm.str()); \
-}
+#define SWARM_LOG_CRITICAL(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_CRITICAL, msg)
 
-#define SWARM_LOG_WARNING(log) \
-{ \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->warning(strm.str()); \
-}
+#define SWARM_LOG_ERROR(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_ERROR, msg)
 
-#define SWARM_LOG_NOTICE(log) \
-{ \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->notice(strm.str()); \
-}
+#define SWARM_LOG_WARNING(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_WARNING, msg)
 
-#define SWARM_LOG_INFO(log) \
-{ \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->information(strm.str()); \
-}
+#define SWARM_LOG_NOTICE(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_NOTICE, msg)
+
+#define SWARM_LOG_INFO(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_INFORMATION, msg)
+
+#define SWARM_LOG_DEBUG(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_DEBUG, msg)
 
-#define SWARM_LOG_DEBUG(log) \
+#define SWARM_LOG_TRACE(msg) SWARM_LOG_CALL_SITE(swarm::Logger::PRIO_TRACE, msg)
+
+//
+// Log a std::exception or a swarm::Exception with its nested chain.  It
+// is rendered into a per-thread buffer only if it is going to be logged.
+//
+#define SWARM_LOG_EXCEPTION(priority, exc) \
 { \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->debug(strm.str()); \
+  static swarm::LogCallSite swarm_log_call_site(__FILE__, __LINE__, __FUNCTION__, priority); \
+  swarm::Logger* swarm_log_logger = swarm::Logger::instance(); \
+  if (swarm_log_logger->willLog(swarm_log_call_site)) \
+    swarm_log_logger->log(swarm_log_call_site, exc); \
 }
 
-#define SWARM_LOG_TRACE(log) \
+//
+// Formatted variants.  The number of {} placeholders in the format
+// is checked against the number of arguments at compile time.
+//
+#if __cplusplus >= 201103L
+#define SWARM_LOGF_CALL_SITE(priority, format, ...) \
 { \
-  std::ostringstream strm; \
-  strm << log; \
-  swarm::Logger::instance()->trace(strm.str()); \
+  static_assert(swarm::LogFormat::placeholders(format) == sizeof(swarm::LogFormat::countArgs(__VA_ARGS__)) - 1, \
+    "the {} placeholders of the log format do not match its arguments"); \
+  static swarm::LogCallSite swarm_log_call_site(__FILE__, __LINE__, __FUNCTION__, priority); \
+  swarm::Logger* swarm_log_logger = swarm::Logger::instance(); \
+  if (swarm_log_logger->willLog(swarm_log_call_site)) \
+    swarm_log_logger->log(swarm_log_call_site, format, __VA_ARGS__); \
 }
 
+#define SWARM_LOGF_FATAL(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_FATAL, format, __VA_ARGS__)
+
+#define SWARM_LOGF_CRITICAL(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_CRITICAL, format, __VA_ARGS__)
+
+#define SWARM_LOGF_ERROR(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_ERROR, format, __VA_ARGS__)
+
+#define SWARM_LOGF_WARNING(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_WARNING, format, __VA_ARGS__)
+
+#define SWARM_LOGF_NOTICE(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_NOTICE, format, __VA_ARGS__)
+
+#define SWARM_LOGF_INFO(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_INFORMATION, format, __VA_ARGS__)
+
+#define SWARM_LOGF_DEBUG(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_DEBUG, format, __VA_ARGS__)
+
+#define SWARM_LOGF_TRACE(format, ...) SWARM_LOGF_CALL_SITE(swarm::Logger::PRIO_TRACE, format, __VA_ARGS__)
+
+#endif
+
 #endif	// SWARM_LOGGER_H_INCLUDED
 
@@ -0,0 +1,113 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_MAPPEDBUFFER_H_INCLUDED
+#define	SWARM_MAPPEDBUFFER_H_INCLUDED
+
+
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+
+
+namespace swarm
+{
+  class MappedBuffer : public boost::noncopyable
+  {
+  public:
+    enum Backing
+    {
+      BACKING_PAGES,                  /// Regular pages
+      BACKING_TRANSPARENT_HUGE_PAGES, /// Regular pages advised to the kernel for THP
+      BACKING_HUGE_PAGES              /// Pages from the hugetlb pool (MAP_HUGETLB)
+    };
+    
+    enum
+    {
+      HUGE_PAGE_SIZE = 2 * 1024 * 1024 /// Size of the huge pages requested
+    };
+    
+    MappedBuffer(std::size_t size, bool hugePages);
+    ///
+    /// Map size bytes of zeroed anonymous memory.  If hugePages is true,
+    /// the mapping is taken from the hugetlb pool if it has enough free
+    /// pages, otherwise it is aligned to a huge page and advised for
+    /// transparent huge pages.  Buffers smaller than a huge page always
+    /// use regular pages.  Throws std::bad_alloc if nothing can be mapped.
+    ///
+    
+    ~MappedBuffer();
+    ///
+    /// Unmap the buffer
+    ///
+    
+    void* data() const;
+    ///
+    /// Returns the start of the buffer
+    ///
+    
+    std::size_t size() const;
+    ///
+    /// Returns the size requested
+    ///
+    
+    std::size_t mappedSize() const;
+    ///
+    /// Returns the size actually mapped, rounded up to the page size
+    ///
+    
+    Backing backing() const;
+    ///
+    /// Returns the kind of pages backing the buffer
+    ///
+    
+  private:
+    void* _pData; /// Start of the mapping
+    std::size_t _size; /// Size requested
+    std::size_t _mappedSize; /// Size mapped
+    Backing _backing; /// Kind of pages
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline void* MappedBuffer::data() const
+  {
+    return _pData;
+  }
+  
+  inline std::size_t MappedBuffer::size() const
+  {
+    return _size;
+  }
+  
+  inline std::size_t MappedBuffer::mappedSize() const
+  {
+    return _mappedSize;
+  }
+  
+  inline MappedBuffer::Backing MappedBuffer::backing() const
+  {
+    return _backing;
+  }
+
+} // swarm
+
+
+#endif	// SWARM_MAPPEDBUFFER_H_INCLUDED
+
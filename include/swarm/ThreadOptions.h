@@ -0,0 +1,110 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_THREADOPTIONS_H_INCLUDED
+#define	SWARM_THREADOPTIONS_H_INCLUDED
+
+
+#include <string>
+#include <vector>
+
+
+namespace swarm
+{
+  struct ThreadOptions
+  {
+    enum IoClass
+    {
+      IO_CLASS_NONE = 0,    /// Keep the inherited I/O priority
+      IO_CLASS_REALTIME,    /// Served first.  Requires CAP_SYS_ADMIN
+      IO_CLASS_BEST_EFFORT, /// The default class of every thread
+      IO_CLASS_IDLE         /// Served only when the disk is otherwise idle
+    };
+    
+    typedef std::vector<int> Cpus;
+    
+    static const int POLICY_INHERIT = -1;
+    
+    Cpus _cpus; /// CPUs the thread may run on.  Empty keeps the inherited affinity
+    int _policy; /// SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO, SCHED_RR or POLICY_INHERIT
+    int _priority; /// Realtime priority for SCHED_FIFO and SCHED_RR, nice value otherwise
+    int _ioClass; /// One of IoClass
+    int _ioLevel; /// I/O priority level within the class, 0 (highest) to 7
+    
+    ThreadOptions();
+    ///
+    /// Creates options that keep every inherited setting
+    ///
+    
+    bool isDefault() const;
+    ///
+    /// Returns true if applying the options would change nothing
+    ///
+    
+    bool apply(std::string& error) const;
+    ///
+    /// Apply the options to the calling thread.  Every setting is
+    /// attempted.  Returns false if any of them failed and sets error
+    /// to the reason.  Raising the scheduling class or I/O class
+    /// usually requires privileges.
+    ///
+    
+    std::string toString() const;
+    ///
+    /// Returns the options as text, e.g.
+    /// cpus=2-3 policy=idle priority=0 io=idle/7
+    ///
+    
+    static ThreadOptions current();
+    ///
+    /// Returns the settings in effect for the calling thread
+    ///
+    
+    static bool parseCpus(const std::string& cpus, Cpus& result);
+    ///
+    /// Parse a CPU list such as 0,2-3.  Returns false if malformed or
+    /// if a CPU number is not below CPU_SETSIZE
+    ///
+    
+    static bool parsePolicy(const std::string& policy, int& result);
+    ///
+    /// Parse a policy name (other, batch, idle, fifo, rr or inherit).
+    /// Returns false if unknown
+    ///
+    
+    static bool parseIoClass(const std::string& ioClass, int& result);
+    ///
+    /// Parse an I/O class name (none, realtime, best-effort or idle).
+    /// Returns false if unknown
+    ///
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline bool ThreadOptions::isDefault() const
+  {
+    return _cpus.empty() && _policy == POLICY_INHERIT && _ioClass == IO_CLASS_NONE;
+  }
+
+} // swarm
+
+
+#endif	// SWARM_THREADOPTIONS_H_INCLUDED
+
@@ -0,0 +1,137 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_TIMERWHEEL_H_INCLUDED
+#define	SWARM_TIMERWHEEL_H_INCLUDED
+
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "swarm/Clock.h"
+
+
+namespace swarm
+{
+  class TimerWheel : boost::noncopyable
+  {
+  public:
+    typedef boost::function<void()> Callback;
+    typedef boost::function<void(const Callback&)> Dispatcher;
+    typedef unsigned long long TimerId;
+    
+    explicit TimerWheel(unsigned long resolutionMilliseconds = 10);
+    ///
+    /// Creates a wheel that advances in steps of the given resolution.
+    /// Delays are rounded up to whole steps.
+    ///
+    
+    bool setResolution(unsigned long resolutionMilliseconds);
+    ///
+    /// Change the resolution.  Returns false if timers are scheduled.
+    ///
+    
+    unsigned long getResolution() const;
+    ///
+    /// Returns the resolution in milliseconds
+    ///
+    
+    void setDispatcher(const Dispatcher& dispatcher);
+    ///
+    /// Hand the callbacks of the expired timers to the dispatcher, e.g.
+    /// to queue them on a worker pool.  An empty dispatcher runs them on
+    /// the thread calling advance().
+    /// Default:  empty
+    ///
+    
+    TimerId schedule(unsigned long delayMilliseconds, const Callback& callback, unsigned long intervalMilliseconds = 0);
+    ///
+    /// Call the callback once the delay expired, then every interval if
+    /// it is not 0.  Scheduling and cancelling take constant time
+    /// whatever the number of timers.  Safe to call from any thread,
+    /// including from the callbacks.  Exceptions thrown by a callback
+    /// run by advance() are ignored.
+    ///
+    
+    bool cancel(TimerId timer);
+    ///
+    /// Cancel the timer.  Returns false if it already expired or was
+    /// cancelled.  A callback already handed to the dispatcher still runs.
+    ///
+    
+    std::size_t advance();
+    ///
+    /// Expire the timers due by now and dispatch their callbacks.
+    /// Returns the number of callbacks dispatched.  Call it at least
+    /// once per resolution, e.g. from a swarm::EventLoop timer.
+    ///
+    
+    std::size_t size() const;
+    ///
+    /// Returns the number of scheduled timers
+    ///
+    
+  private:
+    //
+    // Four levels of 256, 64, 64 and 64 slots hold timers due within
+    // 2^8, 2^14, 2^20 and 2^26 steps.  A slot of an upper level is
+    // spread over the level below whenever the lower level wraps.
+    //
+    static const int ROOT_BITS = 8;
+    static const int LEVEL_BITS = 6;
+    static const int LEVELS = 4;
+    static const std::size_t ROOT_SIZE = 1 << ROOT_BITS;
+    static const std::size_t LEVEL_SIZE = 1 << LEVEL_BITS;
+    static const std::size_t SLOTS = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE;
+    static const boost::int32_t NIL = -1;
+    
+    struct Node
+    {
+      boost::uint64_t expires; /// Step at which the timer is due
+      boost::uint64_t interval; /// Steps between expirations, 0 for once
+      boost::uint32_t generation; /// Incremented when the node is freed
+      boost::int32_t prev;
+      boost::int32_t next;
+      boost::int32_t slot; /// Slot holding the node, NIL if free
+      Callback callback;
+    };
+    
+    boost::uint64_t now() const;
+    void insert(boost::int32_t index);
+    void unlink(boost::int32_t index);
+    void release(boost::int32_t index);
+    std::size_t cascade(int level);
+    
+    mutable boost::mutex _mutex; /// Guards everything below
+    unsigned long _resolution;
+    Clock::Ticks _start; /// Ticks at step 0
+    boost::uint64_t _current; /// Next step to expire
+    std::vector<Node> _nodes; /// Slab of timers, indexed by the low half of a TimerId
+    boost::int32_t _free; /// First free node
+    boost::int32_t _slots[SLOTS]; /// First node of every slot
+    std::size_t _size;
+    Dispatcher _dispatcher;
+  };
+  
+} // swarm
+
+
+#endif	// SWARM_TIMERWHEEL_H_INCLUDED
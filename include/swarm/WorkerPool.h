@@ -0,0 +1,135 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef SWARM_WORKERPOOL_H_INCLUDED
+#define	SWARM_WORKERPOOL_H_INCLUDED
+
+
+#include <deque>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "swarm/ThreadOptions.h"
+
+
+namespace swarm
+{
+  class WorkerPool : boost::noncopyable
+  {
+  public:
+    typedef boost::function<void()> Task;
+    
+    struct Stats
+    {
+      std::size_t threads; /// Running workers
+      unsigned long long submitted; /// Tasks accepted by submit()
+      unsigned long long executed; /// Tasks that ran to completion or threw
+      unsigned long long stolen; /// Tasks taken from the queue of another worker
+      unsigned long long failed; /// Tasks that threw an exception
+      std::size_t pending; /// Tasks waiting in the queues
+    };
+    
+    WorkerPool();
+    
+    ~WorkerPool();
+    ///
+    /// Drains the pool if it is running
+    ///
+    
+    bool start(std::size_t threads, const ThreadOptions& options = ThreadOptions());
+    ///
+    /// Start the given number of workers, or one per CPU if threads is 0.
+    /// Every worker applies the thread options first and ignores the
+    /// settings it is not allowed to change.  Returns false if the pool
+    /// is already running.
+    ///
+    
+    bool submit(const Task& task);
+    ///
+    /// Queue a task.  Tasks submitted by a worker go to its own queue,
+    /// the others are spread over the queues in turn.  Each worker runs
+    /// the newest task of its own queue first and, once it is empty,
+    /// steals the oldest task of another queue.  Tasks must not throw;
+    /// those that do are counted as failed.  Returns false if the pool is
+    /// not running, or draining and the caller is not one of its workers.
+    ///
+    
+    void drain();
+    ///
+    /// Stop accepting tasks from outside the pool, run every queued task,
+    /// including those the tasks submit, and join the workers.  The pool
+    /// can be started again afterwards.  Must not be called by a worker.
+    ///
+    
+    bool isRunning() const;
+    ///
+    /// Returns true if the pool was started and not drained
+    ///
+    
+    void getStats(Stats& stats) const;
+    ///
+    /// Returns the counters of the pool since it was created
+    ///
+    
+  private:
+    struct Worker;
+    
+    void run(Worker* pWorker);
+    bool pop(Worker* pWorker, Task& task);
+    void execute(const Task& task);
+    static void keepWorker(Worker* pWorker);
+    
+    static boost::thread_specific_ptr<Worker> _currentWorker; /// Worker of the calling thread.  Owned by its pool
+    
+    std::vector<Worker*> _workers;
+    std::vector<boost::thread*> _threads;
+    ThreadOptions _threadOptions;
+    mutable boost::mutex _mutex; /// Guards _threads, _running, _stopping and the sleeping workers
+    boost::condition_variable _wakeup;
+    bool _running; /// Started and not yet joined
+    bool _stopping; /// Workers exit once the queues are empty
+    boost::atomic<bool> _accepting; /// Submits from outside the pool are accepted
+    boost::atomic<std::size_t> _submitting; /// Outside submits in progress
+    boost::atomic<std::size_t> _pending; /// Tasks in the queues
+    boost::atomic<std::size_t> _sleeping; /// Workers waiting on _wakeup
+    boost::atomic<std::size_t> _next; /// Queue of the next outside submit
+    boost::atomic<unsigned long long> _submitted;
+    boost::atomic<unsigned long long> _executed;
+    boost::atomic<unsigned long long> _stolen;
+    boost::atomic<unsigned long long> _failed;
+  };
+  
+  //
+  // Inlines
+  //
+  
+  inline bool WorkerPool::isRunning() const
+  {
+    return _accepting.load(boost::memory_order_acquire);
+  }
+  
+} // swarm
+
+
+#endif	// SWARM_WORKERPOOL_H_INCLUDED
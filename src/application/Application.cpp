@@ -6,8 +6,14 @@
 #include <Poco/Util/AbstractConfiguration.h>
 #include "Poco/TaskManager.h"
 #include <Poco/AutoPtr.h>
+#include <Poco/NumberParser.h>
+#include <cstdio>
 #include <iostream>
+#include <set>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/tss.hpp>
 #include "swarm/Application.h"
+#include "swarm/Logger.h"
 
 #if defined(POCO_OS_FAMILY_UNIX) 
 #include <signal.h>
@@ -64,11 +70,36 @@ namespace swarm
       if (_application.stopProcessing())
         return;
       
+      //
+      // Everything since run() was Poco's setup and the option parsing
+      //
+      _application.recordStartupPhase("options", _application._startupTicks);
+      
+#if defined(POCO_OS_FAMILY_UNIX)
+      blockSignals();
+#endif
+      
+      Clock::Ticks start = Clock::ticks();
       loadConfiguration(); // load default configuration files, if present
+      _application.recordStartupPhase("configuration", start);
+      
+      start = Clock::ticks();
       ServerApplication::initialize(self);
+      _application.rebuildSnapshot();
+      _application.reloadLogger();
+      _application.recordStartupPhase("initialize", start);
+      
+      start = Clock::ticks();
+      _application.startWorkerPool();
+      _application.startTimerWheel();
+      _application.recordStartupPhase("workers", start);
       
+      start = Clock::ticks();
       if (_application._initCallback)
         _application._initCallback();
+      _application.recordStartupPhase("init-callback", start);
+      
+      _application.finishStartup();
     }
     
     void reinitialize(Application& self)
@@ -115,19 +146,121 @@ namespace swarm
     // Unix specific code
     //
 #if defined(POCO_OS_FAMILY_UNIX) 
-    int waitForTerminationRequest()
+    void addSignals(sigset_t& sset)
     {
-      sigset_t sset;
       sigemptyset(&sset);
       sigaddset(&sset, SIGINT);
       sigaddset(&sset, SIGQUIT);
       sigaddset(&sset, SIGTERM);
       sigaddset(&sset, SIGHUP);
+#if defined(__linux__)
+      //
+      // Without a callback the user signals keep their default action
+      //
+      if (_application._user1Callback)
+        sigaddset(&sset, SIGUSR1);
+      if (_application._user2Callback)
+        sigaddset(&sset, SIGUSR2);
+#endif
+    }
+    
+    void blockSignals()
+    {
+      //
+      // Block the signals before any thread is created so they all inherit
+      // the mask and the signals are only received by the main thread
+      //
+      sigset_t sset;
+      addSignals(sset);
+      pthread_sigmask(SIG_BLOCK, &sset, NULL);
+    }
+    
+    int waitForTerminationRequest()
+    {
+      sigset_t sset;
+      addSignals(sset);
       sigprocmask(SIG_BLOCK, &sset, NULL);
       int sig;
       sigwait(&sset, &sig);
       return sig;
     }
+    
+    bool hangup()
+    {
+      //
+      // Returns false if the daemon should stop instead
+      //
+      if (!_application._reinitCallback && !_application.getLogger())
+        return false;
+      
+      if (_application._reinitCallback)
+        _application._reinitCallback();
+      
+      //
+      // The reinit callback may have loaded new configuration.
+      // Pick up the new values and the logger settings after it returns.
+      //
+      _application.rebuildSnapshot();
+      _application.reloadLogger();
+      return true;
+    }
+    
+    void onUserSignal(int signal)
+    {
+      if (signal == SIGUSR1 && _application._user1Callback)
+        _application._user1Callback();
+      else if (signal == SIGUSR2 && _application._user2Callback)
+        _application._user2Callback();
+    }
+    
+    void waitForSignals()
+    {
+      for (;;)
+      {
+        int sig = waitForTerminationRequest();
+        if (sig == SIGHUP)
+        {
+          if (!hangup())
+            break;
+        }
+        else if (sig == SIGUSR1 || sig == SIGUSR2)
+        {
+          onUserSignal(sig);
+        }
+        else
+        {
+          break;
+        }
+      }
+    }
+    
+#if defined(__linux__)
+    void onHangup(int)
+    {
+      if (!hangup())
+        _application.eventLoop().stop();
+    }
+    
+    void onTerminate(int)
+    {
+      _application.eventLoop().stop();
+    }
+    
+    bool addLoopSignals(EventLoop& loop)
+    {
+      if (!loop.addSignal(SIGHUP, boost::bind(&Daemon::onHangup, this, _1)) ||
+        !loop.addSignal(SIGINT, boost::bind(&Daemon::onTerminate, this, _1)) ||
+        !loop.addSignal(SIGQUIT, boost::bind(&Daemon::onTerminate, this, _1)) ||
+        !loop.addSignal(SIGTERM, boost::bind(&Daemon::onTerminate, this, _1)))
+        return false;
+      
+      if (_application._user1Callback && !loop.addSignal(SIGUSR1, boost::bind(&Daemon::onUserSignal, this, _1)))
+        return false;
+      if (_application._user2Callback && !loop.addSignal(SIGUSR2, boost::bind(&Daemon::onUserSignal, this, _1)))
+        return false;
+      return true;
+    }
+#endif
 #endif
     
     int main(const std::vector<std::string>& args)
@@ -138,14 +271,28 @@ namespace swarm
         TaskManager tm;
         tm.start(new Worker(_application.mainCallback(), args));
         
-#if defined(POCO_OS_FAMILY_UNIX)        
-        while (SIGHUP == waitForTerminationRequest())
+#if defined(__linux__)
+        EventLoop& loop = _application.eventLoop();
+        TimerWheel& wheel = _application.timerWheel();
+        Logger* pLogger = _application.getLogger();
+        if (addLoopSignals(loop))
         {
-          if (!_application._reinitCallback)
-            break;
-          
-          _application._reinitCallback();
+          if (loop.addTimer(wheel.getResolution(), wheel.getResolution(), boost::bind(&TimerWheel::advance, &wheel)) == -1 && pLogger && pLogger->isOpen())
+            pLogger->error("Application::main - unable to create the timer wheel timer, timers will not expire");
+          loop.run();
+        }
+        else
+        {
+          //
+          // Without the signalfd the signals are still blocked.  Wait for
+          // them with sigwait so the daemon can be stopped.
+          //
+          if (pLogger && pLogger->isOpen())
+            pLogger->error("Application::main - unable to receive signals in the event loop, timers will not expire");
+          waitForSignals();
         }
+#elif defined(POCO_OS_FAMILY_UNIX)
+        waitForSignals();
 #else
         waitForTerminationRequest();
 #endif
@@ -154,6 +301,11 @@ namespace swarm
           _application._terminateCallback();
         }
         
+        //
+        // Let the queued work finish before the main callback is cancelled
+        //
+        _application.workerPool().drain();
+        
         tm.cancelAll();
         tm.joinAll();
       }
@@ -167,15 +319,72 @@ namespace swarm
   
   static Daemon* _pDaemon = 0;
   
+  //
+  // A configuration value parsed once for every getter
+  //
+  struct Application::ConfigValue
+  {
+    std::string raw;
+    std::string string; /// Value with ${} references expanded
+    bool hasString; /// False if the references could not be expanded
+    bool hasInt;
+    bool hasDouble;
+    bool hasBool;
+    int intValue;
+    double doubleValue;
+    bool boolValue;
+    
+    void parse(const Poco::Util::AbstractConfiguration& config, const std::string& key);
+  };
+  
+  struct Application::Snapshot
+  {
+    typedef boost::unordered_map<std::string, ConfigValue> Values;
+    typedef std::set<std::string> Keys;
+    Values values;
+    Keys references; /// Keys whose raw value contains ${} references
+    
+    void update(const Poco::Util::AbstractConfiguration& config, const std::string& key);
+  };
+  
+  //
+  // Each thread keeps a reference to the snapshot it last read, so the
+  // readers do not touch the shared reference count or the mutex until
+  // the version changes.  An old snapshot is released once every thread
+  // has moved on.
+  //
+  struct SnapshotCache
+  {
+    const Application* pOwner;
+    unsigned int version;
+    boost::shared_ptr<const void> pSnapshot;
+  };
+  
+  static boost::thread_specific_ptr<SnapshotCache> snapshotCache;
+  
+  static bool is_live_key(const std::string& key)
+  {
+    return key.compare(0, 7, "system.") == 0;
+  }
+  
   Application::Application() :
-    _stopProcessing(false)
+    _pLogger(0),
+    _loggerPrefix("logger"),
+    _stopProcessing(false),
+    _startupTicks(0),
+    _startupDone(false),
+    _snapshotVersion(0)
   {
     assert(!_pDaemon);
     _pDaemon = new Daemon(*this);
+    _timerWheel.setDispatcher(boost::bind(&Application::dispatchTimer, this, _1));
   }
   
   Application::~Application()
   {
+    for (ConfigSlots::iterator iter = _configSlots.begin(); iter != _configSlots.end(); iter++)
+      delete iter->second;
+    
     delete _pDaemon;
     _pDaemon = 0;
   }
@@ -243,15 +452,498 @@ namespace swarm
   int Application::run(const MainCallback& callback, int argc, char** argv)
   {
     _mainCallback = callback;
+    _startupTicks = Clock::ticks();
+    _startupTimeline.clear();
+    _startupDone = false;
      return _pDaemon->run(argc, argv);
   }
   
   void Application::loadConfiguration(const std::string& path)
   {
+    Clock::Ticks start = Clock::ticks();
     _pDaemon->loadConfiguration(path);
+    recordStartupPhase("load " + path, start);
+    rebuildSnapshot();
+  }
+  
+  void Application::recordStartupPhase(const std::string& name, Clock::Ticks start)
+  {
+    if (_startupDone || !_startupTicks)
+      return;
+    
+    StartupPhase phase;
+    phase.name = name;
+    phase.start = Clock::nanoseconds(start - _startupTicks);
+    phase.duration = Clock::nanoseconds(Clock::ticks() - start);
+    _startupTimeline.push_back(phase);
+  }
+  
+  void Application::finishStartup()
+  {
+    recordStartupPhase("total", _startupTicks);
+    _startupDone = true;
+    
+    if (_pLogger && _pLogger->isOpen())
+      _pLogger->notice("Application startup: " + formatStartupTimeline());
+  }
+  
+  std::string Application::formatStartupTimeline() const
+  {
+    std::string text;
+    for (StartupTimeline::const_iterator iter = _startupTimeline.begin(); iter != _startupTimeline.end(); iter++)
+    {
+      char duration[32];
+      std::snprintf(duration, sizeof(duration), " %.3f ms", iter->duration / 1000000.0);
+      if (!text.empty())
+        text += ", ";
+      text += iter->name;
+      text += duration;
+    }
+    return text;
+  }
+  
+  void Application::Snapshot::update(const Poco::Util::AbstractConfiguration& config, const std::string& key)
+  {
+    ConfigValue& value = values[key];
+    value.parse(config, key);
+    if (value.raw.find("${") != std::string::npos)
+      references.insert(key);
+    else
+      references.erase(key);
+  }
+  
+  static void collect_keys(const Poco::Util::AbstractConfiguration& config, const std::string& prefix, std::vector<std::string>& keys)
+  {
+    Poco::Util::AbstractConfiguration::Keys range;
+    config.keys(prefix, range);
+    for (Poco::Util::AbstractConfiguration::Keys::const_iterator iter = range.begin(); iter != range.end(); iter++)
+    {
+      std::string key = prefix.empty() ? *iter : prefix + "." + *iter;
+      if (is_live_key(key + "."))
+        continue;
+      
+      if (config.hasProperty(key))
+        keys.push_back(key);
+      collect_keys(config, key, keys);
+    }
+  }
+  
+  //
+  // Parse with the configuration's own conversions so the snapshot
+  // returns exactly what the live lookups would
+  //
+  void Application::ConfigValue::parse(const Poco::Util::AbstractConfiguration& config, const std::string& key)
+  {
+    ConfigValue& value = *this;
+    value.hasString = false;
+    value.hasInt = false;
+    value.hasDouble = false;
+    value.hasBool = false;
+    value.intValue = 0;
+    value.doubleValue = 0;
+    value.boolValue = false;
+    
+    if (!config.hasProperty(key))
+      return;
+    
+    value.raw = config.getRawString(key);
+    if (value.raw.find("${") == std::string::npos)
+    {
+      value.string = value.raw;
+    }
+    else
+    {
+      try
+      {
+        value.string = config.getString(key);
+      }
+      catch(...)
+      {
+        return;
+      }
+    }
+    value.hasString = true;
+    
+    //
+    // Same conversions as AbstractConfiguration::getInt(), getDouble()
+    // and getBool(), without an exception for every value that is not
+    // a number or a boolean
+    //
+    const std::string& text = value.string;
+    if (text.compare(0, 2, "0x") == 0 || text.compare(0, 2, "0X") == 0)
+    {
+      unsigned int hex = 0;
+      value.hasInt = Poco::NumberParser::tryParseHex(text.substr(2), hex);
+      if (value.hasInt)
+        value.intValue = static_cast<int>(hex);
+    }
+    else
+    {
+      value.hasInt = Poco::NumberParser::tryParse(text, value.intValue);
+    }
+    
+    value.hasDouble = Poco::NumberParser::tryParseFloat(text, value.doubleValue);
+    value.hasBool = Poco::NumberParser::tryParseBool(text, value.boolValue);
+  }
+  
+  void Application::rebuildSnapshot()
+  {
+    const Poco::Util::AbstractConfiguration& config = _pDaemon->config();
+    std::vector<ConfigSlot::ChangeCallback> callbacks;
+    std::vector<std::string> changed;
+    
+    {
+      boost::mutex::scoped_lock rebuildLock(_rebuildMutex);
+      
+      std::vector<std::string> keys;
+      collect_keys(config, "", keys);
+      
+      boost::shared_ptr<Snapshot> pSnapshot(new Snapshot());
+      for (std::vector<std::string>::const_iterator iter = keys.begin(); iter != keys.end(); iter++)
+        pSnapshot->update(config, *iter);
+      
+      publishSnapshot(pSnapshot, callbacks, changed);
+    }
+    
+    //
+    // The callbacks may read or set the configuration themselves
+    //
+    for (std::size_t i = 0; i < callbacks.size(); i++)
+      callbacks[i](changed[i]);
+  }
+  
+  void Application::updateSnapshot(const std::string& key)
+  {
+    const Poco::Util::AbstractConfiguration& config = _pDaemon->config();
+    std::vector<ConfigSlot::ChangeCallback> callbacks;
+    std::vector<std::string> changed;
+    
+    {
+      boost::mutex::scoped_lock rebuildLock(_rebuildMutex);
+      
+      boost::shared_ptr<const Snapshot> pCurrent;
+      {
+        boost::mutex::scoped_lock lock(_snapshotMutex);
+        pCurrent = _pSnapshot;
+      }
+      
+      if (!pCurrent)
+      {
+        rebuildLock.unlock();
+        rebuildSnapshot();
+        return;
+      }
+      
+      //
+      // Only the set key and the values referencing other keys can change
+      //
+      boost::shared_ptr<Snapshot> pSnapshot(new Snapshot(*pCurrent));
+      if (!is_live_key(key))
+        pSnapshot->update(config, key);
+      
+      for (Snapshot::Keys::const_iterator iter = pCurrent->references.begin(); iter != pCurrent->references.end(); iter++)
+      {
+        if (*iter != key)
+          pSnapshot->update(config, *iter);
+      }
+      
+      publishSnapshot(pSnapshot, callbacks, changed);
+    }
+    
+    for (std::size_t i = 0; i < callbacks.size(); i++)
+      callbacks[i](changed[i]);
+  }
+  
+  void Application::publishSnapshot(const boost::shared_ptr<const Snapshot>& pSnapshot, std::vector<ConfigSlot::ChangeCallback>& callbacks, std::vector<std::string>& changed)
+  {
+    {
+      boost::mutex::scoped_lock lock(_snapshotMutex);
+      _pSnapshot = pSnapshot;
+      _snapshotVersion.fetch_add(1, boost::memory_order_release);
+    }
+    
+    for (ConfigSlots::iterator iter = _configSlots.begin(); iter != _configSlots.end(); iter++)
+    {
+      ConfigSlot& slot = *iter->second;
+      if (fillSlot(slot, *pSnapshot) && !slot._callbacks.empty())
+      {
+        callbacks.insert(callbacks.end(), slot._callbacks.begin(), slot._callbacks.end());
+        changed.insert(changed.end(), slot._callbacks.size(), slot.key());
+      }
+    }
+  }
+  
+  bool Application::fillSlot(ConfigSlot& slot, const Snapshot& snapshot)
+  {
+    const ConfigValue* pValue = 0;
+    ConfigValue live;
+    if (is_live_key(slot.key()))
+    {
+      if (_pDaemon->config().hasProperty(slot.key()))
+      {
+        live.parse(_pDaemon->config(), slot.key());
+        pValue = &live;
+      }
+    }
+    else
+    {
+      Snapshot::Values::const_iterator iter = snapshot.values.find(slot.key());
+      if (iter != snapshot.values.end())
+        pValue = &iter->second;
+    }
+    
+    unsigned int flags = 0;
+    if (pValue)
+    {
+      flags |= ConfigSlot::HAS_KEY;
+      if (pValue->hasString)
+        flags |= ConfigSlot::HAS_STRING;
+      if (pValue->hasInt)
+        flags |= ConfigSlot::HAS_INT;
+      if (pValue->hasDouble)
+        flags |= ConfigSlot::HAS_DOUBLE;
+      if (pValue->hasBool)
+        flags |= ConfigSlot::HAS_BOOL;
+    }
+    
+    unsigned int oldFlags = slot._flags.load(boost::memory_order_relaxed);
+    boost::shared_ptr<const std::string> pOldString = slot._pString;
+    bool changed = flags != oldFlags || ((flags & ConfigSlot::HAS_STRING) && *pOldString != pValue->string);
+    if (!changed)
+      return false;
+    
+    //
+    // The values are stored before the flags that publish them
+    //
+    if (flags & ConfigSlot::HAS_STRING)
+      boost::atomic_store(&slot._pString, boost::shared_ptr<const std::string>(new std::string(pValue->string)));
+    if (flags & ConfigSlot::HAS_INT)
+      slot._int.store(pValue->intValue, boost::memory_order_relaxed);
+    if (flags & ConfigSlot::HAS_DOUBLE)
+    {
+      boost::uint64_t bits;
+      std::memcpy(&bits, &pValue->doubleValue, sizeof(bits));
+      slot._double.store(bits, boost::memory_order_relaxed);
+    }
+    if (flags & ConfigSlot::HAS_BOOL)
+      slot._bool.store(pValue->boolValue, boost::memory_order_relaxed);
+    slot._flags.store(flags, boost::memory_order_release);
+    
+    return true;
+  }
+  
+  ConfigSlot* Application::slot(const std::string& key, const ConfigSlot::ChangeCallback& callback)
+  {
+    boost::mutex::scoped_lock rebuildLock(_rebuildMutex);
+    
+    ConfigSlot*& pSlot = _configSlots[key];
+    if (!pSlot)
+    {
+      pSlot = new ConfigSlot(key);
+      
+      boost::shared_ptr<const Snapshot> pSnapshot;
+      {
+        boost::mutex::scoped_lock lock(_snapshotMutex);
+        pSnapshot = _pSnapshot;
+      }
+      if (pSnapshot)
+        fillSlot(*pSlot, *pSnapshot);
+    }
+    
+    if (callback)
+      pSlot->_callbacks.push_back(callback);
+    
+    return pSlot;
+  }
+  
+  bool Application::lookup(const std::string& key, const ConfigValue*& pValue) const
+  {
+    if (is_live_key(key))
+      return false;
+    
+    SnapshotCache* pCache = snapshotCache.get();
+    if (!pCache)
+    {
+      pCache = new SnapshotCache();
+      pCache->pOwner = 0;
+      pCache->version = 0;
+      snapshotCache.reset(pCache);
+    }
+    
+    unsigned int version = _snapshotVersion.load(boost::memory_order_acquire);
+    if (pCache->pOwner != this || pCache->version != version)
+    {
+      boost::mutex::scoped_lock lock(_snapshotMutex);
+      pCache->pOwner = this;
+      pCache->version = _snapshotVersion.load(boost::memory_order_relaxed);
+      pCache->pSnapshot = _pSnapshot;
+    }
+    
+    const Snapshot* pSnapshot = static_cast<const Snapshot*>(pCache->pSnapshot.get());
+    if (!pSnapshot)
+      return false;
+    
+    Snapshot::Values::const_iterator iter = pSnapshot->values.find(key);
+    if (iter == pSnapshot->values.end())
+    {
+      pValue = 0;
+      return true;
+    }
+    
+    //
+    // Values whose references cannot be expanded report their error live
+    //
+    if (!iter->second.hasString)
+      return false;
+    
+    pValue = &iter->second;
+    return true;
   }
   
   
+  void Application::readThreadOptions(const std::string& prefix, ThreadOptions& threadOptions) const
+  {
+    if (hasProperty(prefix + "cpus") && !ThreadOptions::parseCpus(getString(prefix + "cpus"), threadOptions._cpus))
+      throw swarm::SyntaxException("invalid " + prefix + "cpus");
+    
+    if (hasProperty(prefix + "policy") && !ThreadOptions::parsePolicy(getString(prefix + "policy"), threadOptions._policy))
+      throw swarm::SyntaxException("invalid " + prefix + "policy");
+    
+    if (hasProperty(prefix + "priority"))
+      threadOptions._priority = getInt(prefix + "priority");
+    
+    if (hasProperty(prefix + "io-class") && !ThreadOptions::parseIoClass(getString(prefix + "io-class"), threadOptions._ioClass))
+      throw swarm::SyntaxException("invalid " + prefix + "io-class");
+    
+    if (hasProperty(prefix + "io-level"))
+      threadOptions._ioLevel = getInt(prefix + "io-level");
+  }
+  
+  bool Application::startWorkerPool()
+  {
+    if (!hasProperty("worker-pool.threads"))
+      return false;
+    
+    try
+    {
+      int threads = getInt("worker-pool.threads");
+      ThreadOptions threadOptions;
+      readThreadOptions("worker-pool.thread.", threadOptions);
+      return _workerPool.start(threads < 0 ? 0 : threads, threadOptions);
+    }
+    catch(const swarm::Exception& e)
+    {
+      if (_pLogger && _pLogger->isOpen())
+        _pLogger->warning("Application::startWorkerPool - invalid worker pool configuration: " + e.displayText());
+      return false;
+    }
+  }
+  
+  void Application::startTimerWheel()
+  {
+    int resolution = getInt("timer-wheel.resolution-ms", 0);
+    if (resolution > 0 && !_timerWheel.setResolution(resolution) && _pLogger && _pLogger->isOpen())
+      _pLogger->warning("Application::startTimerWheel - timer-wheel.resolution-ms ignored, timers are already scheduled");
+  }
+  
+  void Application::dispatchTimer(const TimerWheel::Callback& callback)
+  {
+    if (!_workerPool.submit(callback))
+      callback();
+  }
+  
+  bool Application::reloadLogger()
+  {
+    if (!_pLogger)
+      return false;
+    
+    try
+    {
+      std::string path = getString(_loggerPrefix + ".path", _pLogger->getPath());
+      if (path.empty())
+        return false;
+      
+      Logger::Priority priority = Logger::parsePriority(getString(_loggerPrefix + ".priority", ""), _pLogger->getPriority());
+      std::string format = getString(_loggerPrefix + ".format", _pLogger->getLogFormat());
+      int purgeCount = getInt(_loggerPrefix + ".purge-count", _pLogger->getPurgeCount());
+      
+      if (hasProperty(_loggerPrefix + ".verification"))
+        _pLogger->enableVerification(getBool(_loggerPrefix + ".verification"));
+      
+      if (hasProperty(_loggerPrefix + ".call-site-control"))
+        LogCallSite::loadControlFile(getString(_loggerPrefix + ".call-site-control"));
+      
+      //
+      // Placement of the logger threads.  Unset keys keep the current value.
+      //
+      ThreadOptions threadOptions = _pLogger->getThreadOptions();
+      readThreadOptions(_loggerPrefix + ".thread.", threadOptions);
+      
+      _pLogger->setThreadOptions(threadOptions);
+      
+      Logger::SinkMode sinkMode;
+      if (hasProperty(_loggerPrefix + ".sink"))
+      {
+        if (!Logger::parseSinkMode(getString(_loggerPrefix + ".sink"), sinkMode))
+          throw swarm::SyntaxException("invalid " + _loggerPrefix + ".sink");
+        _pLogger->setSinkMode(sinkMode);
+      }
+      
+      if (hasProperty(_loggerPrefix + ".durable-priority"))
+      {
+        std::string durablePriority = getString(_loggerPrefix + ".durable-priority");
+        if (durablePriority == "none")
+          _pLogger->disableDurability();
+        else
+        {
+          int syncWindow = getInt(_loggerPrefix + ".sync-window-us", 1000);
+          _pLogger->enableDurability(Logger::parsePriority(durablePriority, Logger::PRIO_CRITICAL), syncWindow < 0 ? 0 : syncWindow);
+        }
+      }
+      
+      if (hasProperty(_loggerPrefix + ".exception-log"))
+      {
+        std::string exceptionLog = getString(_loggerPrefix + ".exception-log");
+        if (exceptionLog == "none")
+          _pLogger->disableExceptionLog();
+        else
+          _pLogger->enableExceptionLog(Logger::parsePriority(exceptionLog, Logger::PRIO_WARNING));
+      }
+      
+      int preallocation = getInt(_loggerPrefix + ".preallocate", 0);
+      if (hasProperty(_loggerPrefix + ".preallocate"))
+        _pLogger->setPreallocation(preallocation < 0 ? 0 : preallocation);
+      
+      if (hasProperty(_loggerPrefix + ".drop-page-cache"))
+        _pLogger->enableDropCache(getBool(_loggerPrefix + ".drop-page-cache"));
+      
+      int maxRecordSize = getInt(_loggerPrefix + ".max-record-size", 0);
+      if (maxRecordSize > 0)
+        _pLogger->setMaxRecordSize(maxRecordSize);
+      
+      bool reloaded = _pLogger->reload(path, priority, format, purgeCount < 0 ? 0 : purgeCount);
+      
+      if (hasProperty(_loggerPrefix + ".watcher"))
+      {
+        if (getBool(_loggerPrefix + ".watcher"))
+          _pLogger->startWatcher();
+        else
+          _pLogger->stopWatcher();
+      }
+      
+      return reloaded;
+    }
+    catch(const swarm::Exception& e)
+    {
+      //
+      // Bad values in the configuration.  Keep the current logger.
+      //
+      if (_pLogger->isOpen())
+        _pLogger->warning("Application::reloadLogger - invalid logger configuration: " + e.displayText());
+      return false;
+    }
+  }
+  
   void Application::formatHelp(const std::string& usage, const std::string& header, std::ostream& strm)
   {
     HelpFormatter helpFormatter(_pDaemon->options());
@@ -263,6 +955,10 @@ namespace swarm
   
   bool Application::hasProperty(const std::string& key) const
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+      return pValue != 0;
+    
     return _pDaemon->config().hasProperty(key);
   }
 
@@ -272,6 +968,14 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        throw swarm::NotFoundException();
+      return pValue->string;
+    }
+    
     try
     {
       return _pDaemon->config().getString(key);
@@ -288,6 +992,10 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+      return pValue ? pValue->string : defaultValue;
+    
     return _pDaemon->config().getString(key, defaultValue);
   }
 
@@ -296,6 +1004,14 @@ namespace swarm
   /// Throws a NotFoundException if the key does not exist.
   /// References to other properties are not expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        throw swarm::NotFoundException();
+      return pValue->raw;
+    }
+    
     try
     {
       return _pDaemon->config().getRawString(key);
@@ -311,6 +1027,10 @@ namespace swarm
   /// otherwise returns the given default value.
   /// References to other properties are not expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+      return pValue ? pValue->raw : defaultValue;
+    
     return _pDaemon->config().getRawString(key, defaultValue);
   }
 
@@ -323,6 +1043,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        throw swarm::NotFoundException();
+      if (!pValue->hasInt)
+        throw swarm::SyntaxException();
+      return pValue->intValue;
+    }
+    
     try
     {
       return _pDaemon->config().getInt(key);
@@ -346,6 +1076,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        return defaultValue;
+      if (!pValue->hasInt)
+        throw swarm::SyntaxException();
+      return pValue->intValue;
+    }
+    
     try
     {
       return _pDaemon->config().getInt(key, defaultValue);
@@ -364,6 +1104,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        throw swarm::NotFoundException();
+      if (!pValue->hasDouble)
+        throw swarm::SyntaxException();
+      return pValue->doubleValue;
+    }
+    
     try
     {
       return _pDaemon->config().getDouble(key);
@@ -386,6 +1136,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        return defaultValue;
+      if (!pValue->hasDouble)
+        throw swarm::SyntaxException();
+      return pValue->doubleValue;
+    }
+    
     try
     {
       return _pDaemon->config().getDouble(key, defaultValue);
@@ -404,6 +1164,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        throw swarm::NotFoundException();
+      if (!pValue->hasBool)
+        throw swarm::SyntaxException();
+      return pValue->boolValue;
+    }
+    
     try
     {
       return _pDaemon->config().getBool(key);
@@ -430,6 +1200,16 @@ namespace swarm
   /// If the value contains references to other properties (${<property>}), these
   /// are expanded.
   {
+    const ConfigValue* pValue;
+    if (lookup(key, pValue))
+    {
+      if (!pValue)
+        return defaultValue;
+      if (!pValue->hasBool)
+        throw swarm::SyntaxException();
+      return pValue->boolValue;
+    }
+    
     try
     {
       return _pDaemon->config().getBool(key, defaultValue);
@@ -445,6 +1225,7 @@ namespace swarm
   /// An already existing value for the key is overwritten.
   {
     _pDaemon->config().setString(key, value);
+    updateSnapshot(key);
   }
 
   void Application::setInt(const std::string& key, int value)
@@ -452,6 +1233,7 @@ namespace swarm
   /// An already existing value for the key is overwritten.
   {
     _pDaemon->config().setInt(key, value);
+    updateSnapshot(key);
   }
 
   void Application::setDouble(const std::string& key, double value)
@@ -459,6 +1241,7 @@ namespace swarm
   /// An already existing value for the key is overwritten.
   {
     _pDaemon->config().setDouble(key, value);
+    updateSnapshot(key);
   }
 
   void Application::setBool(const std::string& key, bool value)
@@ -466,6 +1249,7 @@ namespace swarm
   /// An already existing value for the key is overwritten.
   {
     _pDaemon->config().setBool(key, value);
+    updateSnapshot(key);
   }
 
   void Application::keys(Keys& range) const
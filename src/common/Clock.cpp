@@ -0,0 +1,251 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "swarm/Clock.h"
+
+#if SWARM_CLOCK_HAS_TSC
+#include <cpuid.h>
+#endif
+
+
+namespace swarm
+{
+  static const unsigned long long CALIBRATION_SPIN_NS = 10000000ULL; /// 10 ms initial calibration
+  static const unsigned long long RECALIBRATION_INTERVAL_NS = 10000000000ULL; /// recalibrate every 10 seconds
+  
+  bool Clock::_tscEnabled = false;
+  
+  //
+  // Calibration state.  It is updated under _calibrationMutex and published
+  // through a sequence counter so readers never take a lock.
+  //
+  static boost::atomic<unsigned int> _calibrationSequence(0);
+  static boost::atomic<unsigned long long> _baseTicks(0);
+  static boost::atomic<unsigned long long> _baseRealtime(0);
+  static boost::atomic<double> _nsPerTick(1.0);
+  static boost::atomic<unsigned long long> _recalibrateTicks(0);
+  static boost::mutex _calibrationMutex;
+  
+  //
+  // First TSC sample against the raw clock.  The rate is measured from
+  // it.  Guarded by _calibrationMutex.
+  //
+  static unsigned long long _rateTicks = 0;
+  static unsigned long long _rateRaw = 0;
+  
+#if defined(CLOCK_MONOTONIC_RAW)
+  static const clockid_t RATE_CLOCK = CLOCK_MONOTONIC_RAW;
+#else
+  static const clockid_t RATE_CLOCK = CLOCK_MONOTONIC;
+#endif
+  
+  static unsigned long long realtime_ns()
+  {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  
+  static unsigned long long clock_ns(clockid_t clock)
+  {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  
+  static unsigned long long monotonic_ns()
+  {
+    return clock_ns(CLOCK_MONOTONIC);
+  }
+  
+  static void read_calibration(unsigned long long& baseTicks, unsigned long long& baseRealtime, double& nsPerTick)
+  {
+    unsigned int sequence;
+    do
+    {
+      sequence = _calibrationSequence.load(boost::memory_order_acquire);
+      baseTicks = _baseTicks.load(boost::memory_order_relaxed);
+      baseRealtime = _baseRealtime.load(boost::memory_order_relaxed);
+      nsPerTick = _nsPerTick.load(boost::memory_order_relaxed);
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+    } while ((sequence & 1) || sequence != _calibrationSequence.load(boost::memory_order_relaxed));
+  }
+  
+#if SWARM_CLOCK_HAS_TSC
+  static void sample_tsc(clockid_t clock, unsigned long long& ticks, unsigned long long& time)
+  {
+    //
+    // Bracket the clock read with two TSC reads and keep the tightest
+    // of a few attempts so that preemption does not skew the pair.
+    //
+    unsigned long long best = ~0ULL;
+    for (int i = 0; i < 5; i++)
+    {
+      unsigned long long before = __builtin_ia32_rdtsc();
+      unsigned long long now = clock_ns(clock);
+      unsigned long long after = __builtin_ia32_rdtsc();
+      if (after - before < best)
+      {
+        best = after - before;
+        ticks = before + (after - before) / 2;
+        time = now;
+      }
+    }
+  }
+#endif
+  
+  bool Clock::hasInvariantTsc()
+  {
+#if SWARM_CLOCK_HAS_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+      return false;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+      return false;
+    return (edx & (1 << 8)) != 0;
+#else
+    return false;
+#endif
+  }
+  
+  bool Clock::enableTsc(bool enable)
+  {
+    if (!enable || !hasInvariantTsc())
+    {
+      _tscEnabled = false;
+      return false;
+    }
+    
+    _tscEnabled = true;
+    calibrate();
+    return true;
+  }
+  
+  static void calibrate_locked()
+  {
+#if SWARM_CLOCK_HAS_TSC
+    double nsPerTick = _nsPerTick.load(boost::memory_order_relaxed);
+    
+    unsigned long long ticks = 0;
+    unsigned long long raw = 0;
+    sample_tsc(RATE_CLOCK, ticks, raw);
+    
+    if (!_rateTicks)
+    {
+      //
+      // First calibration from enableTsc().  Measure the frequency over
+      // a short spin.
+      //
+      _rateTicks = ticks;
+      _rateRaw = raw;
+      unsigned long long start = monotonic_ns();
+      while (monotonic_ns() - start < CALIBRATION_SPIN_NS)
+      {
+      }
+      sample_tsc(RATE_CLOCK, ticks, raw);
+    }
+    
+    //
+    // The rate is measured against the raw monotonic clock since the
+    // first calibration, so steps and slewing of the wall clock do not
+    // distort it and it gets more precise over time
+    //
+    if (ticks > _rateTicks && raw > _rateRaw)
+      nsPerTick = (double)(raw - _rateRaw) / (double)(ticks - _rateTicks);
+    
+    //
+    // Only the offset comes from the wall clock.  Every calibration
+    // rebases on it, which picks up a step in either direction.
+    //
+    unsigned long long baseTicks = 0;
+    unsigned long long baseRealtime = 0;
+    sample_tsc(CLOCK_REALTIME, baseTicks, baseRealtime);
+    
+    _calibrationSequence.fetch_add(1, boost::memory_order_acq_rel);
+    _baseTicks.store(baseTicks, boost::memory_order_relaxed);
+    _baseRealtime.store(baseRealtime, boost::memory_order_relaxed);
+    _nsPerTick.store(nsPerTick, boost::memory_order_relaxed);
+    _recalibrateTicks.store(baseTicks + (unsigned long long)(RECALIBRATION_INTERVAL_NS / nsPerTick), boost::memory_order_relaxed);
+    _calibrationSequence.fetch_add(1, boost::memory_order_release);
+#endif
+  }
+  
+  void Clock::calibrate()
+  {
+    if (!_tscEnabled)
+      return;
+    
+    boost::mutex::scoped_lock lock(_calibrationMutex);
+    calibrate_locked();
+  }
+  
+  unsigned long long Clock::nanoseconds(Ticks elapsed)
+  {
+    if (!_tscEnabled)
+      return elapsed;
+    
+    return (unsigned long long)(elapsed * _nsPerTick.load(boost::memory_order_relaxed));
+  }
+  
+  unsigned long long Clock::realtime(Ticks ticks)
+  {
+    if (!_tscEnabled)
+    {
+      //
+      // Ticks are CLOCK_MONOTONIC nanoseconds.  Shift them by the
+      // current offset between the two clocks.
+      //
+      unsigned long long mono = monotonic();
+      unsigned long long real = realtime_ns();
+      return real - mono + ticks;
+    }
+    
+    if (ticks > _recalibrateTicks.load(boost::memory_order_relaxed))
+    {
+      //
+      // Only one thread needs to recalibrate.  The others keep
+      // converting with the current calibration.
+      //
+      boost::mutex::scoped_try_lock lock(_calibrationMutex);
+      if (lock.owns_lock())
+        calibrate_locked();
+    }
+    
+    unsigned long long baseTicks;
+    unsigned long long baseRealtime;
+    double nsPerTick;
+    read_calibration(baseTicks, baseRealtime, nsPerTick);
+    
+    if (ticks >= baseTicks)
+      return baseRealtime + (unsigned long long)((ticks - baseTicks) * nsPerTick);
+    return baseRealtime - (unsigned long long)((baseTicks - ticks) * nsPerTick);
+  }
+  
+  std::time_t Clock::epochTime()
+  {
+    if (!_tscEnabled)
+      return std::time(0);
+    
+    return (std::time_t)(realtime(ticks()) / 1000000000ULL);
+  }
+  
+} // swarm
@@ -0,0 +1,335 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <boost/cstdint.hpp>
+
+#include "swarm/EventLoop.h"
+#include "swarm/Exception.h"
+
+
+namespace swarm
+{
+  static const int MAX_EVENTS = 32;
+  
+  static void to_timespec(unsigned long milliseconds, timespec& ts)
+  {
+    ts.tv_sec = milliseconds / 1000;
+    ts.tv_nsec = (milliseconds % 1000) * 1000000;
+  }
+  
+  EventLoop::EventLoop() :
+    _epollFd(-1),
+    _wakeupFd(-1),
+    _signalFd(-1),
+    _stopped(false)
+  {
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (_epollFd == -1)
+      throw swarm::SystemException("epoll_create1", std::strerror(errno), errno);
+    
+    _wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Handler handler;
+    handler.type = HANDLER_WAKEUP;
+    handler.oneShot = false;
+    if (_wakeupFd == -1 || !add(_wakeupFd, EPOLLIN, handler))
+    {
+      int error = errno;
+      if (_wakeupFd != -1)
+        close(_wakeupFd);
+      close(_epollFd);
+      throw swarm::SystemException("eventfd", std::strerror(error), error);
+    }
+  }
+  
+  EventLoop::~EventLoop()
+  {
+    for (Handlers::iterator iter = _handlers.begin(); iter != _handlers.end(); iter++)
+    {
+      if (iter->second.type != HANDLER_FD)
+        close(iter->first);
+    }
+    close(_epollFd);
+  }
+  
+  bool EventLoop::add(int fd, unsigned int events, const Handler& handler)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (_handlers.find(fd) != _handlers.end())
+      return false;
+    
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+      return false;
+    
+    _handlers[fd] = handler;
+    return true;
+  }
+  
+  bool EventLoop::addFd(int fd, unsigned int events, const FdCallback& callback)
+  {
+    Handler handler;
+    handler.type = HANDLER_FD;
+    handler.fdCallback = callback;
+    handler.oneShot = false;
+    return add(fd, events, handler);
+  }
+  
+  bool EventLoop::modifyFd(int fd, unsigned int events)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    Handlers::iterator iter = _handlers.find(fd);
+    if (iter == _handlers.end() || iter->second.type != HANDLER_FD)
+      return false;
+    
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event) == 0;
+  }
+  
+  bool EventLoop::removeFd(int fd)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    Handlers::iterator iter = _handlers.find(fd);
+    if (iter == _handlers.end() || iter->second.type != HANDLER_FD)
+      return false;
+    
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, fd, 0);
+    _handlers.erase(iter);
+    return true;
+  }
+  
+  bool EventLoop::addSignal(int signal, const SignalCallback& callback)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (SignalCallbacks::const_iterator iter = _signalCallbacks.begin(); iter != _signalCallbacks.end(); iter++)
+      sigaddset(&mask, iter->first);
+    if (sigaddset(&mask, signal) == -1)
+      return false;
+    
+    //
+    // A signal that is not blocked is delivered the usual way and never
+    // reaches the signalfd
+    //
+    sigset_t blocked;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, signal);
+    if (pthread_sigmask(SIG_BLOCK, &blocked, 0) != 0)
+      return false;
+    
+    int signalFd = signalfd(_signalFd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signalFd == -1)
+      return false;
+    
+    if (_signalFd == -1)
+    {
+      epoll_event event;
+      std::memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = signalFd;
+      if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, signalFd, &event) == -1)
+      {
+        close(signalFd);
+        return false;
+      }
+      
+      Handler handler;
+      handler.type = HANDLER_SIGNAL;
+      handler.oneShot = false;
+      _handlers[signalFd] = handler;
+      _signalFd = signalFd;
+    }
+    
+    _signalCallbacks[signal] = callback;
+    return true;
+  }
+  
+  bool EventLoop::removeSignal(int signal)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (!_signalCallbacks.erase(signal))
+      return false;
+    
+    sigset_t mask;
+    sigemptyset(&mask);
+    for (SignalCallbacks::const_iterator iter = _signalCallbacks.begin(); iter != _signalCallbacks.end(); iter++)
+      sigaddset(&mask, iter->first);
+    return signalfd(_signalFd, &mask, SFD_NONBLOCK | SFD_CLOEXEC) != -1;
+  }
+  
+  EventLoop::TimerId EventLoop::addTimer(unsigned long initialMilliseconds, unsigned long intervalMilliseconds, const TimerCallback& callback)
+  {
+    int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd == -1)
+      return -1;
+    
+    //
+    // An initial expiration of 0 would disarm the timer
+    //
+    itimerspec spec;
+    to_timespec(initialMilliseconds ? initialMilliseconds : 1, spec.it_value);
+    to_timespec(intervalMilliseconds, spec.it_interval);
+    
+    Handler handler;
+    handler.type = HANDLER_TIMER;
+    handler.timerCallback = callback;
+    handler.oneShot = intervalMilliseconds == 0;
+    
+    if (!add(timerFd, EPOLLIN, handler))
+    {
+      close(timerFd);
+      return -1;
+    }
+    
+    if (timerfd_settime(timerFd, 0, &spec, 0) == -1)
+    {
+      cancelTimer(timerFd);
+      return -1;
+    }
+    
+    return timerFd;
+  }
+  
+  bool EventLoop::cancelTimer(TimerId timer)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    Handlers::iterator iter = _handlers.find(timer);
+    if (iter == _handlers.end() || iter->second.type != HANDLER_TIMER)
+      return false;
+    
+    epoll_ctl(_epollFd, EPOLL_CTL_DEL, timer, 0);
+    _handlers.erase(iter);
+    close(timer);
+    return true;
+  }
+  
+  void EventLoop::run()
+  {
+    while (runOnce(-1))
+    {
+    }
+  }
+  
+  bool EventLoop::runOnce(int timeoutMilliseconds)
+  {
+    if (isStopped())
+      return false;
+    
+    epoll_event events[MAX_EVENTS];
+    int count = epoll_wait(_epollFd, events, MAX_EVENTS, timeoutMilliseconds);
+    if (count == -1 && errno != EINTR)
+      throw swarm::SystemException("epoll_wait", std::strerror(errno), errno);
+    
+    for (int i = 0; i < count && !isStopped(); i++)
+      dispatch(events[i].data.fd, events[i].events);
+    
+    return !isStopped();
+  }
+  
+  void EventLoop::stop()
+  {
+    _stopped.store(true, boost::memory_order_release);
+    
+    boost::uint64_t one = 1;
+    ssize_t written = write(_wakeupFd, &one, sizeof(one));
+    (void)written;
+  }
+  
+  void EventLoop::dispatch(int fd, unsigned int events)
+  {
+    //
+    // Copy the callback so it may add or remove handlers, including its own
+    //
+    Handler handler;
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      Handlers::const_iterator iter = _handlers.find(fd);
+      if (iter == _handlers.end())
+        return;
+      handler = iter->second;
+    }
+    
+    switch (handler.type)
+    {
+    case HANDLER_FD:
+      if (handler.fdCallback)
+        handler.fdCallback(fd, events);
+      break;
+      
+    case HANDLER_TIMER:
+      {
+        boost::uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+          break;
+        if (handler.oneShot)
+          cancelTimer(fd);
+        if (handler.timerCallback)
+          handler.timerCallback();
+      }
+      break;
+      
+    case HANDLER_SIGNAL:
+      {
+        signalfd_siginfo info;
+        while (read(fd, &info, sizeof(info)) == sizeof(info))
+        {
+          SignalCallback callback;
+          {
+            boost::mutex::scoped_lock lock(_mutex);
+            SignalCallbacks::const_iterator iter = _signalCallbacks.find((int)info.ssi_signo);
+            if (iter != _signalCallbacks.end())
+              callback = iter->second;
+          }
+          if (callback)
+            callback((int)info.ssi_signo);
+          if (isStopped())
+            break;
+        }
+      }
+      break;
+      
+    case HANDLER_WAKEUP:
+      {
+        boost::uint64_t value;
+        ssize_t result = read(fd, &value, sizeof(value));
+        (void)result;
+      }
+      break;
+    }
+  }
+  
+} // swarm
+
+#endif // __linux__
@@ -18,63 +18,138 @@
 
 
 #include <typeinfo>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <boost/atomic.hpp>
 
 #include "swarm/Exception.h"
 
 
 namespace swarm {
 
-Exception::Exception(int code): _pNested(0), _code(code)
+bool Exception::_captureStack = false;
+
+
+struct Exception::Data
+{
+	boost::atomic<int> refs;
+	std::string msg;     /// Message too long for the string's inline buffer
+	Exception*  pNested; /// Owned nested exception or null
+
+	Data(): refs(1), pNested(0)
+	{
+	}
+
+	~Data()
+	{
+		delete pNested;
+	}
+};
+
+
+Exception::Exception(int code): _pData(0), _pCounter(0), _code(code), _stackDepth(0)
 {
+	captureStack();
+	SWARM_COUNT_EXCEPTION(Exception)
 }
 
 
-Exception::Exception(const std::string& msg, int code): _msg(msg), _pNested(0), _code(code)
+Exception::Exception(const std::string& msg, int code): _pData(0), _pCounter(0), _code(code), _stackDepth(0)
 {
+	captureStack();
+	SWARM_COUNT_EXCEPTION(Exception)
+	setMessage(msg);
 }
 
 
-Exception::Exception(const std::string& msg, const std::string& arg, int code): _msg(msg), _pNested(0), _code(code)
+Exception::Exception(const std::string& msg, const std::string& arg, int code): _pData(0), _pCounter(0), _code(code), _stackDepth(0)
 {
+	captureStack();
+	SWARM_COUNT_EXCEPTION(Exception)
 	if (!arg.empty())
 	{
-		_msg.append(": ");
-		_msg.append(arg);
+		std::string text;
+		text.reserve(msg.size() + 2 + arg.size());
+		text.append(msg);
+		text.append(": ");
+		text.append(arg);
+		setMessage(text);
+	}
+	else
+	{
+		setMessage(msg);
 	}
 }
 
 
-Exception::Exception(const std::string& msg, const Exception& nested, int code): _msg(msg), _pNested(nested.clone()), _code(code)
+Exception::Exception(const std::string& msg, const Exception& nested, int code): _pData(new Data()), _pCounter(0), _code(code), _stackDepth(0)
 {
+	captureStack();
+	SWARM_COUNT_EXCEPTION(Exception)
+	_pData->pNested = nested.clone();
+	setMessage(msg);
 }
 
 
 Exception::Exception(const Exception& exc):
 	std::exception(exc),
 	_msg(exc._msg),
-	_code(exc._code)
+	_pData(exc._pData),
+	_pCounter(0),
+	_code(exc._code),
+	_stackDepth(exc._stackDepth)
+{
+	if (_pData)
+		_pData->refs.fetch_add(1, boost::memory_order_relaxed);
+	std::memcpy(_stack, exc._stack, _stackDepth * sizeof(void*));
+}
+
+#if __cplusplus >= 201103L
+Exception::Exception(Exception&& exc) noexcept:
+	std::exception(exc),
+	_pData(exc._pData),
+	_pCounter(0),
+	_code(exc._code),
+	_stackDepth(exc._stackDepth)
 {
-	_pNested = exc._pNested ? exc._pNested->clone() : 0;
+	_msg.swap(exc._msg);
+	exc._pData = 0;
+	std::memcpy(_stack, exc._stack, _stackDepth * sizeof(void*));
 }
+#endif
 
 Exception::Exception(const std::exception& exc):
-  _pNested(0),
-  _code(0)
+  _pData(0),
+  _pCounter(0),
+  _code(0),
+  _stackDepth(0)
 {
-	_msg = exc.what();
+  captureStack();
+  SWARM_COUNT_EXCEPTION(Exception)
+	setMessage(exc.what());
 }
 
 Exception::Exception(const boost::system::system_error& exc) :
-  _pNested(0),
-  _code(0)
+  _pData(0),
+  _pCounter(0),
+  _code(0),
+  _stackDepth(0)
 {
-  _msg = exc.what();
+  captureStack();
+  SWARM_COUNT_EXCEPTION(Exception)
+  setMessage(exc.what());
   _code = exc.code().value();
 }
 	
 Exception::~Exception() throw()
 {
-	delete _pNested;
+	if (_pCounter)
+		_pCounter->record(*this);
+	release();
 }
 
 
@@ -82,36 +157,101 @@ Exception& Exception::operator = (const Exception& exc)
 {
 	if (&exc != this)
 	{
-		delete _pNested;
+		if (exc._pData)
+			exc._pData->refs.fetch_add(1, boost::memory_order_relaxed);
+		release();
 		_msg     = exc._msg;
-		_pNested = exc._pNested ? exc._pNested->clone() : 0;
+		_pData   = exc._pData;
 		_code    = exc._code;
+		_stackDepth = exc._stackDepth;
+		std::memcpy(_stack, exc._stack, _stackDepth * sizeof(void*));
 	}
 	return *this;
 }
 
 
+#if __cplusplus >= 201103L
+Exception& Exception::operator = (Exception&& exc) noexcept
+{
+	if (&exc != this)
+	{
+		release();
+		_msg.clear();
+		_msg.swap(exc._msg);
+		_pData   = exc._pData;
+		exc._pData = 0;
+		_code    = exc._code;
+		_stackDepth = exc._stackDepth;
+		std::memcpy(_stack, exc._stack, _stackDepth * sizeof(void*));
+	}
+	return *this;
+}
+#endif
+
+
 Exception& Exception::operator = (const std::exception& exc)
 {
   if (&exc != this)
 	{
-		delete _pNested;
-    _pNested = 0;
+		release();
     _code = 0;
-    _msg = exc.what();
+    _msg.clear();
+    _stackDepth = 0;
+    captureStack();
+    setMessage(exc.what());
 	}
 	return *this;
 }
 
 Exception& Exception::operator = (const boost::system::system_error& exc)
 {
-  delete _pNested;
-  _pNested = 0;
+  release();
   _code = exc.code().value();
-  _msg = exc.what();
+  _msg.clear();
+  _stackDepth = 0;
+  captureStack();
+  setMessage(exc.what());
 	return *this;
 }
 
+const Exception* Exception::nested() const
+{
+	return _pData ? _pData->pNested : 0;
+}
+
+
+const std::string& Exception::message() const
+{
+	return _msg.empty() && _pData ? _pData->msg : _msg;
+}
+
+
+void Exception::setMessage(const std::string& msg)
+{
+	//
+	// A short message is copied within the string's inline buffer for
+	// free.  A long one is stored once and shared by the copies.
+	//
+	static const std::string::size_type inlineCapacity = std::string().capacity();
+	if (msg.size() <= inlineCapacity)
+	{
+		_msg = msg;
+		return;
+	}
+
+	if (!_pData)
+		_pData = new Data();
+	_pData->msg = msg;
+}
+
+
+void Exception::release()
+{
+	if (_pData && _pData->refs.fetch_sub(1, boost::memory_order_acq_rel) == 1)
+		delete _pData;
+	_pData = 0;
+}
+
 const char* Exception::name() const throw()
 {
 	return "Exception";
@@ -126,24 +266,138 @@ const char* Exception::className() const throw()
 	
 const char* Exception::what() const throw()
 {
-  if(_msg.empty())
+  const std::string& msg = message();
+  if(msg.empty())
     return name();
-  return _msg.c_str();
+  return msg.c_str();
 }
 
 	
 std::string Exception::displayText() const
 {
 	std::string txt = name();
-	if (!_msg.empty())
+	const std::string& msg = message();
+	if (!msg.empty())
 	{
 		txt.append(": ");
-		txt.append(_msg);
+		txt.append(msg);
+	}
+	if (_stackDepth)
+	{
+		txt.append("\n");
+		txt.append(stackTrace());
 	}
 	return txt;
 }
 
 
+void Exception::captureStack()
+{
+	if (!_captureStack)
+		return;
+
+	//
+	// Leave out this frame
+	//
+	void* frames[MAX_STACK_DEPTH + 1];
+	int depth = backtrace(frames, MAX_STACK_DEPTH + 1);
+	if (depth > 1)
+	{
+		_stackDepth = depth - 1;
+		std::memcpy(_stack, frames + 1, _stackDepth * sizeof(void*));
+	}
+}
+
+
+std::string Exception::stackAddresses() const
+{
+	std::string addresses;
+	for (unsigned int i = 0; i < _stackDepth; i++)
+	{
+		if (i)
+			addresses.append(" ");
+
+		//
+		// Module relative offsets survive address space randomization
+		//
+		char offset[32];
+		Dl_info info;
+		if (dladdr(_stack[i], &info) && info.dli_fname)
+		{
+			std::snprintf(offset, sizeof(offset), "+0x%lx", (unsigned long)((char*)_stack[i] - (char*)info.dli_fbase));
+			addresses.append(info.dli_fname);
+		}
+		else
+		{
+			std::snprintf(offset, sizeof(offset), "%p", _stack[i]);
+		}
+		addresses.append(offset);
+	}
+	return addresses;
+}
+
+
+std::string Exception::stackTrace() const
+{
+	std::string trace;
+	if (!_stackDepth)
+		return trace;
+
+	char** symbols = backtrace_symbols(_stack, _stackDepth);
+	if (!symbols)
+		return stackAddresses();
+
+	for (unsigned int i = 0; i < _stackDepth; i++)
+	{
+		if (i)
+			trace.append("\n");
+
+		//
+		// Entries look like module(mangled+0x1f) [0x4005d6]
+		//
+		std::string frame = symbols[i];
+		std::string::size_type begin = frame.find('(');
+		std::string::size_type end = frame.find('+', begin);
+		if (begin != std::string::npos && end != std::string::npos && end > begin + 1)
+		{
+			int status = 0;
+			char* demangled = abi::__cxa_demangle(frame.substr(begin + 1, end - begin - 1).c_str(), 0, 0, &status);
+			if (demangled && status == 0)
+				frame.replace(begin + 1, end - begin - 1, demangled);
+			std::free(demangled);
+		}
+
+		trace.append("  at ");
+		trace.append(frame);
+	}
+
+	std::free(symbols);
+	return trace;
+}
+
+
+ExceptionCounter& Exception::counter()
+{
+	static ExceptionCounter counter("Exception", typeid(Exception).name());
+	return counter;
+}
+
+
+void Exception::enableStackCapture(bool enable)
+{
+	if (enable)
+	{
+		//
+		// The first backtrace() loads the unwinder, which allocates.
+		// Do it now rather than in the first exception.
+		//
+		void* frame;
+		backtrace(&frame, 1);
+	}
+	_captureStack = enable;
+}
+
+
 Exception* Exception::clone() const
 {
 	return new Exception(*this);
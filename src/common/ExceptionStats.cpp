@@ -0,0 +1,274 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include <ctime>
+#include <pthread.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "swarm/ExceptionStats.h"
+#include "swarm/Exception.h"
+#include "swarm/Clock.h"
+
+
+namespace swarm
+{
+  bool ExceptionStats::_enabled = false;
+  
+  //
+  // Counters register while static objects are constructed, so the
+  // registry must not depend on dynamic initialization
+  //
+  static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+  static ExceptionCounter* pCounters = 0;
+  
+  //
+  // A hook stays alive while it is called.  clearLogHook() waits for its
+  // calls to drop to zero before its owner may go away.
+  //
+  struct HookState
+  {
+    ExceptionStats::LogHookId id;
+    ExceptionStats::LogHook hook;
+    unsigned int calls; /// Calls in progress.  Guarded by hookMutex()
+  };
+  
+  typedef boost::shared_ptr<HookState> HookStatePtr;
+  
+  static boost::mutex& hookMutex()
+  {
+    static boost::mutex mutex;
+    return mutex;
+  }
+  
+  static boost::condition_variable& hookIdle()
+  {
+    static boost::condition_variable condition;
+    return condition;
+  }
+  
+  static HookStatePtr& logHook()
+  {
+    static HookStatePtr pHook;
+    return pHook;
+  }
+  
+  static ExceptionStats::LogHookId lastHookId = 0; /// Guarded by hookMutex()
+  
+  //
+  // The hook called on this thread, if any, so a hook clearing itself does
+  // not wait for its own call.  Not owned.
+  //
+  static boost::thread_specific_ptr<HookState>& callingHook()
+  {
+    static boost::thread_specific_ptr<HookState> pHook(0);
+    return pHook;
+  }
+  
+  static boost::atomic<bool> hasLogHook(false);
+  
+  static boost::thread_specific_ptr<unsigned int>& logGuards()
+  {
+    static boost::thread_specific_ptr<unsigned int> guards;
+    return guards;
+  }
+  
+  ExceptionCounter::ExceptionCounter(const char* name, const char* className) :
+    _name(name),
+    _className(className),
+    _count(0),
+    _loggedSecond(0),
+    _listedCount(0),
+    _listedTime(Clock::ticks()),
+    _pNext(0)
+  {
+    pthread_mutex_lock(&registryMutex);
+    _pNext = pCounters;
+    pCounters = this;
+    pthread_mutex_unlock(&registryMutex);
+  }
+  
+  void ExceptionCounter::record(const Exception& exc)
+  {
+    unsigned long long count = _count.fetch_add(1, boost::memory_order_relaxed) + 1;
+    
+    if (!hasLogHook.load(boost::memory_order_relaxed))
+      return;
+    
+    //
+    // An exception ending inside the logger must not use up the second
+    // of its class
+    //
+    unsigned int* pGuards = logGuards().get();
+    if (pGuards && *pGuards)
+      return;
+    
+    //
+    // One record per class and second.  The thread that moves the
+    // second forward logs it.
+    //
+    long now = Clock::epochTime();
+    long logged = _loggedSecond.load(boost::memory_order_relaxed);
+    if (logged == now || !_loggedSecond.compare_exchange_strong(logged, now))
+      return;
+    
+    try
+    {
+      //
+      // The displayText() of the exception.  It is built here because
+      // record() runs in ~Exception, where name() already returns the
+      // base class name.
+      //
+      std::string text = _name;
+      const std::string& message = exc.message();
+      if (!message.empty())
+      {
+        text += ": ";
+        text += message;
+      }
+      text += " [";
+      text += _className;
+      text += ", ";
+      text += boost::lexical_cast<std::string>(count);
+      text += " so far]";
+      if (exc.stackDepth())
+      {
+        text += "\n";
+        text += exc.stackTrace();
+      }
+      
+      HookStatePtr pHook;
+      {
+        boost::mutex::scoped_lock lock(hookMutex());
+        pHook = logHook();
+        if (!pHook)
+          return;
+        pHook->calls++;
+      }
+      
+      //
+      // Exceptions ending inside the hook are not logged again
+      //
+      {
+        ExceptionStats::LogGuard guard;
+        HookState* pCalling = callingHook().get();
+        callingHook().reset(pHook.get());
+        try
+        {
+          pHook->hook(text);
+        }
+        catch (...)
+        {
+        }
+        callingHook().reset(pCalling);
+      }
+      
+      boost::mutex::scoped_lock lock(hookMutex());
+      if (!--pHook->calls)
+        hookIdle().notify_all();
+    }
+    catch (...)
+    {
+      //
+      // Called from exception destructors.  Nothing may escape.
+      //
+    }
+  }
+  
+  ExceptionStats::LogGuard::LogGuard()
+  {
+    unsigned int* pGuards = logGuards().get();
+    if (!pGuards)
+    {
+      pGuards = new unsigned int(0);
+      logGuards().reset(pGuards);
+    }
+    ++*pGuards;
+  }
+  
+  ExceptionStats::LogGuard::~LogGuard()
+  {
+    --*logGuards();
+  }
+  
+  void ExceptionStats::enable(bool enable)
+  {
+    _enabled = enable;
+  }
+  
+  ExceptionStats::LogHookId ExceptionStats::setLogHook(const LogHook& hook)
+  {
+    HookStatePtr pHook(new HookState());
+    pHook->hook = hook;
+    pHook->calls = 0;
+    
+    boost::mutex::scoped_lock lock(hookMutex());
+    pHook->id = ++lastHookId;
+    logHook() = pHook;
+    hasLogHook = true;
+    return pHook->id;
+  }
+  
+  bool ExceptionStats::clearLogHook(LogHookId id)
+  {
+    boost::mutex::scoped_lock lock(hookMutex());
+    HookStatePtr pHook = logHook();
+    if (!pHook || pHook->id != id)
+      return false;
+    
+    logHook().reset();
+    hasLogHook = false;
+    
+    unsigned int own = callingHook().get() == pHook.get() ? 1 : 0;
+    while (pHook->calls > own)
+      hookIdle().wait(lock);
+    return true;
+  }
+  
+  void ExceptionStats::list(Entries& entries)
+  {
+    entries.clear();
+    Clock::Ticks now = Clock::ticks();
+    
+    pthread_mutex_lock(&registryMutex);
+    for (ExceptionCounter* pCounter = pCounters; pCounter; pCounter = pCounter->_pNext)
+    {
+      Entry entry;
+      entry.name = pCounter->_name;
+      entry.className = pCounter->_className;
+      entry.count = pCounter->count();
+      
+      unsigned long long elapsed = Clock::nanoseconds(now - pCounter->_listedTime);
+      entry.rate = elapsed ? (entry.count - pCounter->_listedCount) * 1e9 / elapsed : 0;
+      pCounter->_listedCount = entry.count;
+      pCounter->_listedTime = now;
+      
+      //
+      // Base classes register when a subclass is constructed
+      //
+      if (entry.count)
+        entries.push_back(entry);
+    }
+    pthread_mutex_unlock(&registryMutex);
+  }
+  
+} // swarm
+
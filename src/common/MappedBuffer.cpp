@@ -0,0 +1,101 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include <new>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "swarm/MappedBuffer.h"
+
+
+namespace swarm
+{
+  static std::size_t round_up(std::size_t size, std::size_t alignment)
+  {
+    return (size + alignment - 1) / alignment * alignment;
+  }
+  
+  static void* map_anonymous(std::size_t size, int flags)
+  {
+    void* pData = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return pData == MAP_FAILED ? 0 : pData;
+  }
+  
+  MappedBuffer::MappedBuffer(std::size_t size, bool hugePages) :
+    _pData(0),
+    _size(size),
+    _mappedSize(0),
+    _backing(BACKING_PAGES)
+  {
+    std::size_t pageSize = (std::size_t)sysconf(_SC_PAGESIZE);
+    
+    if (hugePages && size >= HUGE_PAGE_SIZE)
+    {
+#if defined(MAP_HUGETLB)
+      //
+      // Explicit huge pages.  This fails unless the administrator
+      // reserved enough of them (vm.nr_hugepages).
+      //
+      _mappedSize = round_up(size, HUGE_PAGE_SIZE);
+      _pData = map_anonymous(_mappedSize, MAP_HUGETLB);
+      if (_pData)
+      {
+        _backing = BACKING_HUGE_PAGES;
+        return;
+      }
+#endif
+      
+#if defined(MADV_HUGEPAGE)
+      //
+      // Transparent huge pages.  The kernel only backs huge page aligned
+      // ranges with huge pages so over-allocate, then trim both ends.
+      //
+      _mappedSize = round_up(size, HUGE_PAGE_SIZE);
+      char* pMapping = (char*)map_anonymous(_mappedSize + HUGE_PAGE_SIZE, 0);
+      if (pMapping)
+      {
+        char* pAligned = (char*)round_up((std::size_t)pMapping, HUGE_PAGE_SIZE);
+        std::size_t head = pAligned - pMapping;
+        std::size_t tail = HUGE_PAGE_SIZE - head;
+        if (head)
+          munmap(pMapping, head);
+        if (tail)
+          munmap(pAligned + _mappedSize, tail);
+        
+        _pData = pAligned;
+        if (madvise(_pData, _mappedSize, MADV_HUGEPAGE) == 0)
+          _backing = BACKING_TRANSPARENT_HUGE_PAGES;
+        return;
+      }
+#endif
+    }
+    
+    _mappedSize = round_up(size ? size : 1, pageSize);
+    _pData = map_anonymous(_mappedSize, 0);
+    if (!_pData)
+      throw std::bad_alloc();
+  }
+  
+  MappedBuffer::~MappedBuffer()
+  {
+    if (_pData)
+      munmap(_pData, _mappedSize);
+  }
+
+} // swarm
+
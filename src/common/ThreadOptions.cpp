@@ -0,0 +1,317 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "swarm/ThreadOptions.h"
+
+
+namespace swarm
+{
+  //
+  // The glibc does not wrap the ioprio system calls.  These are the
+  // values from linux/ioprio.h
+  //
+  static const int IOPRIO_WHO_PROCESS = 1;
+  static const int IOPRIO_CLASS_SHIFT = 13;
+  static const int IOPRIO_LEVEL_MASK = 0x7;
+  
+  //
+  // Upper bound of the CPU numbers in a CPU list
+  //
+#if defined(CPU_SETSIZE)
+  static const long MAX_CPUS = CPU_SETSIZE;
+#else
+  static const long MAX_CPUS = 1024;
+#endif
+  
+  struct PolicyName
+  {
+    const char* name;
+    int policy;
+  };
+  
+  static const PolicyName policyNames[] =
+  {
+    { "inherit", ThreadOptions::POLICY_INHERIT },
+    { "other", SCHED_OTHER },
+#if defined(SCHED_BATCH)
+    { "batch", SCHED_BATCH },
+#endif
+#if defined(SCHED_IDLE)
+    { "idle", SCHED_IDLE },
+#endif
+    { "fifo", SCHED_FIFO },
+    { "rr", SCHED_RR }
+  };
+  
+  static const char* ioClassNames[] =
+  {
+    "none", "realtime", "best-effort", "idle"
+  };
+  
+  static bool is_realtime(int policy)
+  {
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+  }
+  
+  static void append_error(std::string& error, const char* call)
+  {
+    if (!error.empty())
+      error += "; ";
+    error += call;
+    error += ": ";
+    error += std::strerror(errno);
+  }
+  
+  ThreadOptions::ThreadOptions() :
+    _policy(POLICY_INHERIT),
+    _priority(0),
+    _ioClass(IO_CLASS_NONE),
+    _ioLevel(4)
+  {
+  }
+  
+  bool ThreadOptions::apply(std::string& error) const
+  {
+    error.clear();
+    
+#if defined(__linux__)
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    
+    if (!_cpus.empty())
+    {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (Cpus::const_iterator iter = _cpus.begin(); iter != _cpus.end(); iter++)
+      {
+        if (*iter >= 0 && *iter < CPU_SETSIZE)
+          CPU_SET(*iter, &set);
+      }
+      
+      if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+        append_error(error, "pthread_setaffinity_np");
+    }
+    
+    if (_policy != POLICY_INHERIT)
+    {
+      sched_param param;
+      std::memset(&param, 0, sizeof(param));
+      param.sched_priority = is_realtime(_policy) ? _priority : 0;
+      
+      int result = pthread_setschedparam(pthread_self(), _policy, &param);
+      if (result != 0)
+      {
+        errno = result;
+        append_error(error, "pthread_setschedparam");
+      }
+      else if (!is_realtime(_policy) && setpriority(PRIO_PROCESS, tid, _priority) != 0)
+      {
+        //
+        // Linux keeps the nice value per thread
+        //
+        append_error(error, "setpriority");
+      }
+    }
+    
+    if (_ioClass != IO_CLASS_NONE)
+    {
+      int ioprio = (_ioClass << IOPRIO_CLASS_SHIFT) | (_ioLevel & IOPRIO_LEVEL_MASK);
+      if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, ioprio) != 0)
+        append_error(error, "ioprio_set");
+    }
+#else
+    if (!isDefault())
+      error = "thread options are not supported on this platform";
+#endif
+    
+    return error.empty();
+  }
+  
+  ThreadOptions ThreadOptions::current()
+  {
+    ThreadOptions options;
+    
+#if defined(__linux__)
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+    {
+      for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+      {
+        if (CPU_ISSET(cpu, &set))
+          options._cpus.push_back(cpu);
+      }
+    }
+    
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &options._policy, &param) == 0)
+    {
+      if (is_realtime(options._policy))
+      {
+        options._priority = param.sched_priority;
+      }
+      else
+      {
+        errno = 0;
+        int nice = getpriority(PRIO_PROCESS, tid);
+        options._priority = errno ? 0 : nice;
+      }
+    }
+    
+    long ioprio = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, tid);
+    if (ioprio >= 0)
+    {
+      options._ioClass = (int)(ioprio >> IOPRIO_CLASS_SHIFT);
+      options._ioLevel = (int)(ioprio & IOPRIO_LEVEL_MASK);
+    }
+#endif
+    
+    return options;
+  }
+  
+  std::string ThreadOptions::toString() const
+  {
+    std::ostringstream strm;
+    
+    strm << "cpus=";
+    if (_cpus.empty())
+      strm << "inherit";
+    
+    //
+    // Print runs of consecutive CPUs as ranges
+    //
+    for (std::size_t i = 0; i < _cpus.size(); )
+    {
+      std::size_t j = i;
+      while (j + 1 < _cpus.size() && _cpus[j + 1] == _cpus[j] + 1)
+        j++;
+      
+      if (i)
+        strm << ",";
+      strm << _cpus[i];
+      if (j > i)
+        strm << "-" << _cpus[j];
+      i = j + 1;
+    }
+    
+    strm << " policy=";
+    const char* policy = 0;
+    for (std::size_t i = 0; i < sizeof(policyNames) / sizeof(policyNames[0]); i++)
+    {
+      if (policyNames[i].policy == _policy)
+        policy = policyNames[i].name;
+    }
+    if (policy)
+      strm << policy;
+    else
+      strm << _policy;
+    
+    strm << " priority=" << _priority;
+    
+    strm << " io=";
+    if (_ioClass >= IO_CLASS_NONE && _ioClass <= IO_CLASS_IDLE)
+      strm << ioClassNames[_ioClass];
+    else
+      strm << _ioClass;
+    strm << "/" << _ioLevel;
+    
+    return strm.str();
+  }
+  
+  bool ThreadOptions::parseCpus(const std::string& cpus, Cpus& result)
+  {
+    result.clear();
+    
+    const char* p = cpus.c_str();
+    while (*p)
+    {
+      char* end;
+      long first = std::strtol(p, &end, 10);
+      if (end == p || first < 0)
+        return false;
+      
+      long last = first;
+      p = end;
+      if (*p == '-')
+      {
+        last = std::strtol(++p, &end, 10);
+        if (end == p || last < first)
+          return false;
+        p = end;
+      }
+      
+      if (last >= MAX_CPUS)
+        return false;
+      
+      for (long cpu = first; cpu <= last; cpu++)
+        result.push_back((int)cpu);
+      
+      while (*p == ' ')
+        p++;
+      if (*p == ',')
+        p++;
+      else if (*p)
+        return false;
+      while (*p == ' ')
+        p++;
+    }
+    
+    return true;
+  }
+  
+  bool ThreadOptions::parsePolicy(const std::string& policy, int& result)
+  {
+    for (std::size_t i = 0; i < sizeof(policyNames) / sizeof(policyNames[0]); i++)
+    {
+      if (policy == policyNames[i].name)
+      {
+        result = policyNames[i].policy;
+        return true;
+      }
+    }
+    return false;
+  }
+  
+  bool ThreadOptions::parseIoClass(const std::string& ioClass, int& result)
+  {
+    for (int i = IO_CLASS_NONE; i <= IO_CLASS_IDLE; i++)
+    {
+      if (ioClass == ioClassNames[i])
+      {
+        result = i;
+        return true;
+      }
+    }
+    return false;
+  }
+
+} // swarm
+
@@ -0,0 +1,262 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include "swarm/TimerWheel.h"
+
+
+namespace swarm
+{
+  TimerWheel::TimerWheel(unsigned long resolutionMilliseconds) :
+    _resolution(resolutionMilliseconds ? resolutionMilliseconds : 1),
+    _start(Clock::ticks()),
+    _current(0),
+    _free(NIL),
+    _size(0)
+  {
+    for (std::size_t i = 0; i < SLOTS; i++)
+      _slots[i] = NIL;
+  }
+  
+  bool TimerWheel::setResolution(unsigned long resolutionMilliseconds)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (_size)
+      return false;
+    
+    _resolution = resolutionMilliseconds ? resolutionMilliseconds : 1;
+    _start = Clock::ticks();
+    _current = 0;
+    return true;
+  }
+  
+  unsigned long TimerWheel::getResolution() const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _resolution;
+  }
+  
+  void TimerWheel::setDispatcher(const Dispatcher& dispatcher)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _dispatcher = dispatcher;
+  }
+  
+  std::size_t TimerWheel::size() const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    return _size;
+  }
+  
+  boost::uint64_t TimerWheel::now() const
+  {
+    return Clock::nanoseconds(Clock::ticks() - _start) / 1000000;
+  }
+  
+  TimerWheel::TimerId TimerWheel::schedule(unsigned long delayMilliseconds, const Callback& callback, unsigned long intervalMilliseconds)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    boost::int32_t index = _free;
+    if (index != NIL)
+    {
+      _free = _nodes[index].next;
+    }
+    else
+    {
+      index = (boost::int32_t)_nodes.size();
+      _nodes.push_back(Node());
+      _nodes[index].generation = 1;
+    }
+    
+    //
+    // Round up so the timer never fires before its delay
+    //
+    Node& node = _nodes[index];
+    node.expires = (now() + delayMilliseconds + _resolution - 1) / _resolution;
+    if (node.expires < _current)
+      node.expires = _current;
+    node.interval = intervalMilliseconds ? (intervalMilliseconds + _resolution - 1) / _resolution : 0;
+    node.callback = callback;
+    insert(index);
+    _size++;
+    
+    return ((TimerId)node.generation << 32) | (boost::uint32_t)index;
+  }
+  
+  bool TimerWheel::cancel(TimerId timer)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    
+    boost::uint32_t index = (boost::uint32_t)timer;
+    if (index >= _nodes.size())
+      return false;
+    
+    Node& node = _nodes[index];
+    if (node.slot == NIL || node.generation != (boost::uint32_t)(timer >> 32))
+      return false;
+    
+    unlink((boost::int32_t)index);
+    release((boost::int32_t)index);
+    return true;
+  }
+  
+  void TimerWheel::insert(boost::int32_t index)
+  {
+    Node& node = _nodes[index];
+    boost::uint64_t expires = node.expires;
+    boost::uint64_t delta = expires > _current ? expires - _current : 0;
+    
+    boost::int32_t slot;
+    if (delta < ROOT_SIZE)
+    {
+      slot = (boost::int32_t)(expires & (ROOT_SIZE - 1));
+    }
+    else
+    {
+      //
+      // Timers beyond the top level wait in its last slot and are placed
+      // again when it is spread
+      //
+      int top = ROOT_BITS + (LEVELS - 1) * LEVEL_BITS;
+      if (delta >= ((boost::uint64_t)1 << top))
+        expires = _current + ((boost::uint64_t)1 << top) - 1;
+      
+      int level = 1;
+      while (level < LEVELS - 1 && delta >= ((boost::uint64_t)1 << (ROOT_BITS + level * LEVEL_BITS)))
+        level++;
+      
+      int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+      slot = (boost::int32_t)(ROOT_SIZE + (level - 1) * LEVEL_SIZE + ((expires >> shift) & (LEVEL_SIZE - 1)));
+    }
+    
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = _slots[slot];
+    if (node.next != NIL)
+      _nodes[node.next].prev = index;
+    _slots[slot] = index;
+  }
+  
+  void TimerWheel::unlink(boost::int32_t index)
+  {
+    Node& node = _nodes[index];
+    if (node.prev != NIL)
+      _nodes[node.prev].next = node.next;
+    else
+      _slots[node.slot] = node.next;
+    if (node.next != NIL)
+      _nodes[node.next].prev = node.prev;
+    node.slot = NIL;
+  }
+  
+  void TimerWheel::release(boost::int32_t index)
+  {
+    Node& node = _nodes[index];
+    node.callback.clear();
+    node.slot = NIL;
+    if (++node.generation == 0)
+      node.generation = 1;
+    node.next = _free;
+    _free = index;
+    _size--;
+  }
+  
+  std::size_t TimerWheel::cascade(int level)
+  {
+    int shift = ROOT_BITS + (level - 1) * LEVEL_BITS;
+    std::size_t index = (std::size_t)((_current >> shift) & (LEVEL_SIZE - 1));
+    boost::int32_t slot = (boost::int32_t)(ROOT_SIZE + (level - 1) * LEVEL_SIZE + index);
+    
+    boost::int32_t next = _slots[slot];
+    _slots[slot] = NIL;
+    while (next != NIL)
+    {
+      boost::int32_t current = next;
+      next = _nodes[current].next;
+      insert(current);
+    }
+    
+    return index;
+  }
+  
+  std::size_t TimerWheel::advance()
+  {
+    std::vector<Callback> due;
+    Dispatcher dispatcher;
+    
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      boost::uint64_t target = now() / _resolution;
+      
+      for (; _current <= target; _current++)
+      {
+        std::size_t index = (std::size_t)(_current & (ROOT_SIZE - 1));
+        if (!index)
+        {
+          for (int level = 1; level < LEVELS && !cascade(level); level++)
+          {
+          }
+        }
+        
+        boost::int32_t next = _slots[index];
+        _slots[index] = NIL;
+        while (next != NIL)
+        {
+          boost::int32_t current = next;
+          Node& node = _nodes[current];
+          next = node.next;
+          
+          due.push_back(node.callback);
+          if (node.interval)
+          {
+            node.expires += node.interval;
+            if (node.expires <= _current)
+              node.expires = _current + 1;
+            insert(current);
+          }
+          else
+          {
+            release(current);
+          }
+        }
+      }
+      
+      dispatcher = _dispatcher;
+    }
+    
+    //
+    // Run the callbacks unlocked so they may schedule and cancel timers
+    //
+    for (std::vector<Callback>::const_iterator iter = due.begin(); iter != due.end(); iter++)
+    {
+      try
+      {
+        if (dispatcher)
+          dispatcher(*iter);
+        else
+          (*iter)();
+      }
+      catch(...)
+      {
+      }
+    }
+    
+    return due.size();
+  }
+  
+} // swarm
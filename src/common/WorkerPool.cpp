@@ -0,0 +1,271 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include <boost/bind.hpp>
+
+#include "swarm/WorkerPool.h"
+
+
+namespace swarm
+{
+  struct WorkerPool::Worker
+  {
+    WorkerPool* pPool;
+    std::size_t index;
+    boost::mutex mutex; /// Guards tasks
+    std::deque<Task> tasks;
+  };
+  
+  boost::thread_specific_ptr<WorkerPool::Worker> WorkerPool::_currentWorker(&WorkerPool::keepWorker);
+  
+  WorkerPool::WorkerPool() :
+    _running(false),
+    _stopping(false),
+    _accepting(false),
+    _submitting(0),
+    _pending(0),
+    _sleeping(0),
+    _next(0),
+    _submitted(0),
+    _executed(0),
+    _stolen(0),
+    _failed(0)
+  {
+  }
+  
+  WorkerPool::~WorkerPool()
+  {
+    drain();
+  }
+  
+  bool WorkerPool::start(std::size_t threads, const ThreadOptions& options)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    if (_running)
+      return false;
+    
+    if (!threads)
+      threads = boost::thread::hardware_concurrency();
+    if (!threads)
+      threads = 1;
+    
+    _threadOptions = options;
+    _running = true;
+    _stopping = false;
+    
+    for (std::size_t i = 0; i < threads; i++)
+    {
+      Worker* pWorker = new Worker();
+      pWorker->pPool = this;
+      pWorker->index = i;
+      _workers.push_back(pWorker);
+    }
+    
+    for (std::size_t i = 0; i < threads; i++)
+      _threads.push_back(new boost::thread(boost::bind(&WorkerPool::run, this, _workers[i])));
+    
+    _accepting.store(true, boost::memory_order_release);
+    return true;
+  }
+  
+  bool WorkerPool::submit(const Task& task)
+  {
+    Worker* pWorker = _currentWorker.get();
+    if (pWorker && pWorker->pPool == this)
+    {
+      //
+      // A worker of this pool is running, so the pool cannot finish
+      // draining before the task is queued
+      //
+      _pending.fetch_add(1);
+      {
+        boost::mutex::scoped_lock lock(pWorker->mutex);
+        pWorker->tasks.push_back(task);
+      }
+    }
+    else
+    {
+      //
+      // drain() waits for the outside submits in progress before it lets
+      // the workers exit
+      //
+      _submitting.fetch_add(1);
+      if (!_accepting.load())
+      {
+        _submitting.fetch_sub(1);
+        return false;
+      }
+      
+      _pending.fetch_add(1);
+      pWorker = _workers[_next.fetch_add(1, boost::memory_order_relaxed) % _workers.size()];
+      {
+        boost::mutex::scoped_lock lock(pWorker->mutex);
+        pWorker->tasks.push_back(task);
+      }
+      _submitting.fetch_sub(1);
+    }
+    
+    _submitted.fetch_add(1, boost::memory_order_relaxed);
+    
+    //
+    // A worker increments _sleeping before it checks _pending, so either
+    // it sees the task or the submitter sees it sleeping
+    //
+    if (_sleeping.load())
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _wakeup.notify_one();
+    }
+    
+    return true;
+  }
+  
+  void WorkerPool::drain()
+  {
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      if (!_running)
+        return;
+    }
+    
+    _accepting.store(false);
+    while (_submitting.load())
+      boost::this_thread::yield();
+    
+    {
+      boost::mutex::scoped_lock lock(_mutex);
+      _stopping = true;
+      _wakeup.notify_all();
+    }
+    
+    for (std::vector<boost::thread*>::iterator iter = _threads.begin(); iter != _threads.end(); iter++)
+      (*iter)->join();
+    
+    for (std::vector<Worker*>::iterator iter = _workers.begin(); iter != _workers.end(); iter++)
+      delete *iter;
+    _workers.clear();
+    
+    boost::mutex::scoped_lock lock(_mutex);
+    for (std::vector<boost::thread*>::iterator iter = _threads.begin(); iter != _threads.end(); iter++)
+      delete *iter;
+    _threads.clear();
+    _running = false;
+    _stopping = false;
+  }
+  
+  void WorkerPool::getStats(Stats& stats) const
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    stats.threads = _threads.size();
+    stats.submitted = _submitted.load(boost::memory_order_relaxed);
+    stats.executed = _executed.load(boost::memory_order_relaxed);
+    stats.stolen = _stolen.load(boost::memory_order_relaxed);
+    stats.failed = _failed.load(boost::memory_order_relaxed);
+    stats.pending = _pending.load(boost::memory_order_relaxed);
+  }
+  
+  void WorkerPool::run(Worker* pWorker)
+  {
+    if (!_threadOptions.isDefault())
+    {
+      std::string error;
+      _threadOptions.apply(error);
+    }
+    
+    _currentWorker.reset(pWorker);
+    
+    Task task;
+    for (;;)
+    {
+      if (pop(pWorker, task))
+      {
+        execute(task);
+        task.clear();
+        continue;
+      }
+      
+      //
+      // A submitter counts the task before it queues it
+      //
+      if (_pending.load())
+      {
+        boost::this_thread::yield();
+        continue;
+      }
+      
+      boost::mutex::scoped_lock lock(_mutex);
+      _sleeping.fetch_add(1);
+      while (!_pending.load() && !_stopping)
+        _wakeup.wait(lock);
+      _sleeping.fetch_sub(1);
+      
+      if (!_pending.load() && _stopping)
+        break;
+    }
+    
+    _currentWorker.reset();
+  }
+  
+  bool WorkerPool::pop(Worker* pWorker, Task& task)
+  {
+    {
+      boost::mutex::scoped_lock lock(pWorker->mutex);
+      if (!pWorker->tasks.empty())
+      {
+        task.swap(pWorker->tasks.back());
+        pWorker->tasks.pop_back();
+        _pending.fetch_sub(1);
+        return true;
+      }
+    }
+    
+    for (std::size_t i = 1; i < _workers.size(); i++)
+    {
+      Worker* pVictim = _workers[(pWorker->index + i) % _workers.size()];
+      boost::mutex::scoped_lock lock(pVictim->mutex);
+      if (!pVictim->tasks.empty())
+      {
+        task.swap(pVictim->tasks.front());
+        pVictim->tasks.pop_front();
+        _pending.fetch_sub(1);
+        _stolen.fetch_add(1, boost::memory_order_relaxed);
+        return true;
+      }
+    }
+    
+    return false;
+  }
+  
+  void WorkerPool::keepWorker(Worker*)
+  {
+  }
+  
+  void WorkerPool::execute(const Task& task)
+  {
+    try
+    {
+      task();
+    }
+    catch(...)
+    {
+      _failed.fetch_add(1, boost::memory_order_relaxed);
+    }
+    _executed.fetch_add(1, boost::memory_order_relaxed);
+  }
+  
+} // swarm
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <sys/select.h>
 #include "swarm/Application.h"
+#include "swarm/Logger.h"
 
 
 class MyApplication
@@ -165,6 +166,13 @@ public:
 int main(int argc, char** argv)
 {
   swarm::Application swarmApp;
+  
+  //
+  // The logger is configured from the logger.* keys and
+  // reconfigured on SIGHUP
+  //
+  swarmApp.setLogger(swarm::Logger::instance());
+  
   MyApplication myApp(swarmApp);
   return swarmApp.run(boost::bind(&MyApplication::MyMain, &myApp, _1), argc, argv);
 }
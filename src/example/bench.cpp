@@ -0,0 +1,297 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Throughput and latency benchmark for swarm::Logger.
+//
+// Usage: swarm_logger_bench [log-file] [messages-per-run] [max-threads]
+//
+// Every run of the matrix prints one JSON object per line to stdout so the
+// results can be collected and compared across versions.  Heap allocations
+// are counted by replacing the global operator new; a steady-state logging
+// path reports 0 allocations_per_message.  The exit status is 1 if the
+// method, buffer or format calls allocate after the warm-up.
+//
+
+#include <time.h>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/atomic.hpp>
+
+#include "swarm/Logger.h"
+
+
+typedef unsigned long long nanoseconds;
+
+static boost::atomic<unsigned long long> allocations(0);
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+void* operator new(std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+  allocations.fetch_add(1, boost::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+  std::free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) throw()
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) throw()
+{
+  std::free(p);
+}
+#endif
+
+static nanoseconds now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (nanoseconds)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+enum BenchCall
+{
+  CALL_MACRO,   /// SWARM_LOG_INFO(payload)
+  CALL_METHOD,  /// Logger::information(const std::string&)
+  CALL_BUFFER,  /// Logger::information(boost::string_ref)
+  CALL_FORMAT   /// Logger::information(format, args...)
+};
+
+static const char* callNames[] = { "macro", "method", "buffer", "format" };
+
+static const std::size_t WARMUP_MESSAGES = 16;
+
+struct BenchConfig
+{
+  unsigned int threads;
+  std::size_t messageSize;
+  bool levelEnabled;
+  bool verification;
+  BenchCall call;
+};
+
+static void bench_call(const BenchConfig& config, swarm::Logger* pLogger, const std::string& payload, std::size_t i)
+{
+  switch (config.call)
+  {
+    case CALL_MACRO:
+      if (config.levelEnabled)
+      {
+        SWARM_LOG_INFO(payload);
+      }
+      else
+      {
+        SWARM_LOG_DEBUG(payload);
+      }
+      break;
+    case CALL_METHOD:
+      if (config.levelEnabled)
+        pLogger->information(payload);
+      else
+        pLogger->debug(payload);
+      break;
+    case CALL_BUFFER:
+      if (config.levelEnabled)
+        pLogger->information(boost::string_ref(payload.data(), payload.size()));
+      else
+        pLogger->debug(boost::string_ref(payload.data(), payload.size()));
+      break;
+    case CALL_FORMAT:
+#if __cplusplus >= 201103L
+      if (config.levelEnabled)
+        pLogger->information("{} {}", i, payload);
+      else
+        pLogger->debug("{} {}", i, payload);
+#else
+      (void)i;
+#endif
+      break;
+  }
+}
+
+static void bench_worker(
+  const BenchConfig& config,
+  const std::string& payload,
+  std::size_t count,
+  nanoseconds* pLatencies,
+  boost::barrier* pBarrier)
+{
+  swarm::Logger* pLogger = swarm::Logger::instance();
+  
+  //
+  // Grow the per thread buffers before the allocations are counted
+  //
+  for (std::size_t i = 0; i < WARMUP_MESSAGES; i++)
+    bench_call(config, pLogger, payload, count + i);
+  
+  pBarrier->wait();
+
+  for (std::size_t i = 0; i < count; i++)
+  {
+    nanoseconds start = now_ns();
+    bench_call(config, pLogger, payload, i);
+    pLatencies[i] = now_ns() - start;
+  }
+}
+
+static nanoseconds percentile(const std::vector<nanoseconds>& sorted, double pct)
+{
+  if (sorted.empty())
+    return 0;
+  std::size_t index = (std::size_t)(pct / 100.0 * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static unsigned long long run_bench(const BenchConfig& config, std::size_t messages)
+{
+  swarm::Logger* pLogger = swarm::Logger::instance();
+  pLogger->enableVerification(config.verification);
+
+  std::string payload(config.messageSize, 'x');
+  std::size_t perThread = messages / config.threads;
+  if (perThread == 0)
+    perThread = 1;
+
+  std::vector<nanoseconds> latencies(perThread * config.threads);
+  boost::barrier barrier(config.threads + 1);
+  boost::thread_group threads;
+
+  for (unsigned int t = 0; t < config.threads; t++)
+  {
+    threads.create_thread(boost::bind(&bench_worker, boost::cref(config), boost::cref(payload), perThread, &latencies[t * perThread], &barrier));
+  }
+
+  barrier.wait();
+  unsigned long long startAllocations = allocations.load();
+  nanoseconds start = now_ns();
+  threads.join_all();
+  nanoseconds elapsed = now_ns() - start;
+  unsigned long long runAllocations = allocations.load() - startAllocations;
+
+  std::sort(latencies.begin(), latencies.end());
+  double seconds = elapsed / 1e9;
+  double rate = seconds > 0 ? latencies.size() / seconds : 0;
+
+  std::cout << "{"
+    << "\"threads\":" << config.threads
+    << ",\"message_size\":" << config.messageSize
+    << ",\"level_enabled\":" << (config.levelEnabled ? "true" : "false")
+    << ",\"verification\":" << (config.verification ? "true" : "false")
+    << ",\"call\":\"" << callNames[config.call] << "\""
+    << ",\"messages\":" << latencies.size()
+    << ",\"elapsed_ns\":" << elapsed
+    << ",\"messages_per_sec\":" << (unsigned long long)rate
+    << ",\"p50_ns\":" << percentile(latencies, 50.0)
+    << ",\"p99_ns\":" << percentile(latencies, 99.0)
+    << ",\"p999_ns\":" << percentile(latencies, 99.9)
+    << ",\"allocations_per_message\":" << (double)runAllocations / latencies.size()
+    << "}" << std::endl;
+  
+  return runAllocations;
+}
+
+int main(int argc, char** argv)
+{
+  boost::filesystem::path path(argc > 1 ? argv[1] : "swarm_logger_bench.log");
+  std::size_t messages = argc > 2 ? std::strtoul(argv[2], 0, 10) : 100000;
+  unsigned int maxThreads = argc > 3 ? std::strtoul(argv[3], 0, 10) : 64;
+
+  if (!swarm::Logger::instance()->open(path.string(), swarm::Logger::PRIO_INFORMATION))
+  {
+    std::cerr << swarm::Logger::instance()->getLastError() << std::endl;
+    return 1;
+  }
+
+  static const std::size_t messageSizes[] = { 16, 128, 1024 };
+  unsigned int failures = 0;
+
+  for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    for (std::size_t s = 0; s < sizeof(messageSizes) / sizeof(messageSizes[0]); s++)
+    {
+      for (int enabled = 1; enabled >= 0; enabled--)
+      {
+        for (int verification = 1; verification >= 0; verification--)
+        {
+          for (int call = CALL_MACRO; call <= CALL_FORMAT; call++)
+          {
+#if __cplusplus < 201103L
+            if (call == CALL_FORMAT)
+              continue;
+#endif
+            BenchConfig config;
+            config.threads = threads;
+            config.messageSize = messageSizes[s];
+            config.levelEnabled = enabled;
+            config.verification = verification;
+            config.call = (BenchCall)call;
+            unsigned long long runAllocations = run_bench(config, messages);
+            
+            //
+            // The method, buffer and format paths must not allocate once
+            // the buffers have grown
+            //
+            if (runAllocations && config.call != CALL_MACRO)
+            {
+              std::cerr << "allocation check failed: " << callNames[config.call] << " made "
+                << runAllocations << " allocations in steady state" << std::endl;
+              failures++;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  swarm::Logger::releaseInstance();
+  boost::filesystem::remove(path);
+
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+//
+// Cost of creating, throwing, copying, cloning and rethrowing
+// swarm::Exception.
+//
+// Usage: swarm_exception_bench [iterations]
+//
+// Each case prints one JSON object per line to stdout with the time and
+// the number of heap allocations per operation.  Allocations are counted
+// by replacing the global operator new.
+//
+
+#include <time.h>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <iostream>
+#include <boost/atomic.hpp>
+
+#include "swarm/Exception.h"
+
+
+typedef unsigned long long nanoseconds;
+
+static boost::atomic<unsigned long long> allocations(0);
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#endif
+
+void* operator new(std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+  allocations.fetch_add(1, boost::memory_order_relaxed);
+  void* p = std::malloc(size ? size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](std::size_t size) BENCH_THROW_BAD_ALLOC
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+  std::free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+  std::free(p);
+}
+
+#ifdef __cpp_sized_deallocation
+void operator delete(void* p, std::size_t) throw()
+{
+  std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) throw()
+{
+  std::free(p);
+}
+#endif
+
+static nanoseconds now_ns()
+{
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (nanoseconds)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const std::string shortMessage = "not found";
+static const std::string longMessage = "configuration key logger.thread.io-class could not be found";
+
+static swarm::Exception* pNested = 0;
+static volatile std::size_t sink = 0;
+
+enum BenchCase
+{
+  CASE_THROW_SHORT,   /// throw and catch with a short message
+  CASE_THROW_LONG,    /// throw and catch with a long message
+  CASE_THROW_NESTED,  /// throw and catch wrapping a chain of 3 exceptions
+  CASE_COPY,          /// copy an exception with a nested chain
+  CASE_CLONE,         /// clone() and delete an exception with a nested chain
+  CASE_RETHROW,       /// rethrow() a stored exception with a nested chain
+  CASE_MOVE           /// move an exception with a nested chain
+};
+
+static const char* caseNames[] =
+{
+  "throw_short", "throw_long", "throw_nested", "copy", "clone", "rethrow", "move"
+};
+
+static void run_case(BenchCase benchCase, std::size_t iterations)
+{
+  swarm::RuntimeException stored(longMessage, *pNested);
+  
+  unsigned long long startAllocations = allocations.load();
+  nanoseconds start = now_ns();
+  
+  for (std::size_t i = 0; i < iterations; i++)
+  {
+    switch (benchCase)
+    {
+      case CASE_THROW_SHORT:
+        try
+        {
+          throw swarm::NotFoundException(shortMessage);
+        }
+        catch (const swarm::Exception& e)
+        {
+          sink += e.code();
+        }
+        break;
+      case CASE_THROW_LONG:
+        try
+        {
+          throw swarm::NotFoundException(longMessage);
+        }
+        catch (const swarm::Exception& e)
+        {
+          sink += e.code();
+        }
+        break;
+      case CASE_THROW_NESTED:
+        try
+        {
+          throw swarm::RuntimeException(shortMessage, *pNested);
+        }
+        catch (const swarm::Exception& e)
+        {
+          sink += e.code();
+        }
+        break;
+      case CASE_COPY:
+        {
+          swarm::RuntimeException copy(stored);
+          sink += copy.code();
+        }
+        break;
+      case CASE_CLONE:
+        {
+          swarm::Exception* pClone = stored.clone();
+          sink += pClone->code();
+          delete pClone;
+        }
+        break;
+      case CASE_RETHROW:
+        try
+        {
+          stored.rethrow();
+        }
+        catch (const swarm::Exception& e)
+        {
+          sink += e.code();
+        }
+        break;
+      case CASE_MOVE:
+#if __cplusplus >= 201103L
+        {
+          swarm::RuntimeException moved(std::move(stored));
+          stored = std::move(moved);
+          sink += stored.code();
+        }
+#endif
+        break;
+    }
+  }
+  
+  nanoseconds elapsed = now_ns() - start;
+  unsigned long long runAllocations = allocations.load() - startAllocations;
+  
+  std::cout << "{"
+    << "\"case\":\"" << caseNames[benchCase] << "\""
+    << ",\"iterations\":" << iterations
+    << ",\"ns_per_op\":" << (double)elapsed / iterations
+    << ",\"allocations_per_op\":" << (double)runAllocations / iterations
+    << "}" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  std::size_t iterations = argc > 1 ? std::strtoul(argv[1], 0, 10) : 1000000;
+  if (iterations == 0)
+    iterations = 1;
+  
+  swarm::FileNotFoundException root(longMessage, 2);
+  swarm::IOException middle(longMessage, root);
+  pNested = swarm::RuntimeException(longMessage, middle).clone();
+  
+  for (int benchCase = CASE_THROW_SHORT; benchCase <= CASE_MOVE; benchCase++)
+  {
+#if __cplusplus < 201103L
+    if (benchCase == CASE_MOVE)
+      continue;
+#endif
+    run_case((BenchCase)benchCase, iterations);
+  }
+  
+  delete pNested;
+  return 0;
+}
+
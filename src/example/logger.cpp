@@ -20,6 +20,7 @@
 #include <iostream>
 
 #include "swarm/Logger.h"
+#include "swarm/LogSpan.h"
 
 
 int main(int argc, char** argv) 
@@ -40,6 +41,15 @@ int main(int argc, char** argv)
   SWARM_LOG_DEBUG("This is a sample DEBUG log");
   SWARM_LOG_TRACE("This is a sample TRACE log");
   
+#if __cplusplus >= 201103L
+  SWARM_LOGF_INFO("This is a sample formatted {} log number {}", "INFO", 1);
+#endif
+  
+  {
+    SWARM_LOG_SPAN_THRESHOLD("sample span", 1000);
+    SWARM_LOG_INFO("This is a sample INFO log inside a timed span");
+  }
+  
   swarm::Logger::releaseInstance();
   
   return 0;
@@ -0,0 +1,266 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <boost/thread/thread.hpp>
+
+#include "swarm/AppendChannel.h"
+#include "swarm/Exception.h"
+
+
+namespace swarm
+{
+  static const char TRUNCATED_MARKER[] = " [truncated]";
+  static const std::size_t MIN_RECORD_SIZE = sizeof(TRUNCATED_MARKER) + 1;
+  
+  AppendChannel::AppendChannel(const std::string& path) :
+    _path(path),
+    _fd(-1),
+    _maxRecordSize(DEFAULT_MAX_RECORD_SIZE),
+    _written(0),
+    _synced(0),
+    _syncing(false),
+    _preallocation(0),
+    _dropCache(false),
+    _size(0),
+    _allocated(0),
+    _writebackStart(0),
+    _dropStart(0)
+  {
+  }
+  
+  AppendChannel::~AppendChannel()
+  {
+    close();
+  }
+  
+  void AppendChannel::open()
+  {
+    if (_fd != -1)
+      return;
+    
+    int flags = O_WRONLY | O_CREAT | O_APPEND;
+#if defined(O_CLOEXEC)
+    flags |= O_CLOEXEC;
+#endif
+    
+    _fd = ::open(_path.c_str(), flags, 0644);
+    if (_fd == -1)
+      throw OpenFileException(_path, std::strerror(errno));
+    
+    struct stat st;
+    _size = fstat(_fd, &st) == 0 ? st.st_size : 0;
+    _allocated = _size;
+    _writebackStart = _size;
+    _dropStart = _size;
+  }
+  
+  void AppendChannel::close()
+  {
+    boost::mutex::scoped_lock lock(_syncMutex);
+    
+    if (_fd == -1)
+      return;
+    
+    //
+    // Let a group sync in progress finish with the descriptor, then
+    // cover whoever is still waiting with a last one.
+    //
+    while (_syncing)
+      _syncCondition.wait(lock);
+    
+    fdatasync(_fd);
+    _synced = _written.load(boost::memory_order_acquire);
+    _syncCondition.notify_all();
+    
+    //
+    // Give back the reserved space past the end of the file
+    //
+    struct stat st;
+    if (_allocated > _size && fstat(_fd, &st) == 0)
+      ftruncate(_fd, st.st_size);
+    
+    if (_dropCache)
+      dropCache(true);
+    
+    ::close(_fd);
+    _fd = -1;
+  }
+  
+  void AppendChannel::sync(unsigned long long records, unsigned int windowMicroseconds)
+  {
+    boost::mutex::scoped_lock lock(_syncMutex);
+    
+    while (_synced < records)
+    {
+      if (_syncing || _fd == -1)
+      {
+        //
+        // Follower.  The running sync may already cover our records.
+        //
+        _syncCondition.wait(lock);
+        continue;
+      }
+      
+      //
+      // Leader.  Give other writers the batching window to join, then
+      // sync everything that has been written by then.
+      //
+      _syncing = true;
+      lock.unlock();
+      
+      if (windowMicroseconds)
+        boost::this_thread::sleep(boost::posix_time::microseconds(windowMicroseconds));
+      
+      unsigned long long target = _written.load(boost::memory_order_acquire);
+      int result = fdatasync(_fd);
+      int error = errno;
+      
+      lock.lock();
+      _syncing = false;
+      if (result == 0 && target > _synced)
+        _synced = target;
+      _syncCondition.notify_all();
+      
+      if (result != 0)
+        throw WriteFileException(_path, std::strerror(error));
+    }
+  }
+  
+  void AppendChannel::log(const Poco::Message& msg)
+  {
+    boost::mutex::scoped_lock lock(_mutex);
+    _buffer = msg.getText();
+    write(_buffer);
+  }
+  
+  void AppendChannel::write(std::string& record)
+  {
+    if (_fd == -1)
+      open();
+    
+    if (record.size() + 1 > _maxRecordSize)
+    {
+      record.resize(_maxRecordSize - MIN_RECORD_SIZE + 1);
+      record.append(TRUNCATED_MARKER, sizeof(TRUNCATED_MARKER) - 1);
+    }
+    record += '\n';
+    
+    if (_preallocation)
+      preallocate(record.size());
+    
+    //
+    // A short write only happens when the disk is full or on signals
+    // with some file systems.  Finish the record so the next one
+    // starts on a line of its own.
+    //
+    const char* data = record.data();
+    std::size_t remaining = record.size();
+    while (remaining)
+    {
+      ssize_t written = ::write(_fd, data, remaining);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        throw WriteFileException(_path, std::strerror(errno));
+      }
+      data += written;
+      remaining -= written;
+    }
+    
+    _written.fetch_add(1, boost::memory_order_release);
+    
+    _size += record.size();
+    if (_dropCache && _size - _writebackStart >= DROP_CACHE_WINDOW)
+      dropCache(false);
+  }
+  
+  void AppendChannel::preallocate(std::size_t length)
+  {
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    if (_size + length <= _allocated)
+      return;
+    
+    //
+    // Other processes may have appended since the last chunk
+    //
+    struct stat st;
+    if (fstat(_fd, &st) == 0 && (unsigned long long)st.st_size > _size)
+      _size = st.st_size;
+    
+    unsigned long long start = _allocated > _size ? _allocated : _size;
+    if (fallocate(_fd, FALLOC_FL_KEEP_SIZE, start, _preallocation) == 0)
+    {
+      _allocated = start + _preallocation;
+    }
+    else if (errno == EOPNOTSUPP)
+    {
+      //
+      // The file system cannot reserve space.  Stop trying.
+      //
+      _preallocation = 0;
+    }
+#else
+    (void)length;
+    _preallocation = 0;
+#endif
+  }
+  
+  void AppendChannel::dropCache(bool all)
+  {
+    //
+    // Dirty pages cannot be dropped.  Start writing the new window now
+    // and drop the previous one, which had a window's time to complete.
+    //
+#if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+    if (_size > _writebackStart)
+      sync_file_range(_fd, _writebackStart, _size - _writebackStart, SYNC_FILE_RANGE_WRITE);
+#endif
+    
+    unsigned long long dropEnd = all ? _size : _writebackStart;
+    if (dropEnd > _dropStart)
+      posix_fadvise(_fd, _dropStart, dropEnd - _dropStart, POSIX_FADV_DONTNEED);
+    
+    _dropStart = dropEnd;
+    _writebackStart = _size;
+  }
+  
+  void AppendChannel::setPreallocation(std::size_t chunk)
+  {
+    _preallocation = chunk;
+  }
+  
+  void AppendChannel::enableDropCache(bool enable)
+  {
+    _dropCache = enable;
+  }
+  
+  void AppendChannel::setMaxRecordSize(std::size_t size)
+  {
+    _maxRecordSize = size < MIN_RECORD_SIZE ? MIN_RECORD_SIZE : size;
+  }
+
+} // swarm
+
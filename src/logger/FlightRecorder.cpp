@@ -0,0 +1,132 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstring>
+#include <new>
+
+#include "swarm/FlightRecorder.h"
+
+
+namespace swarm
+{
+  
+  FlightRecorder::FlightRecorder(std::size_t capacity, bool hugePages) :
+    _buffer((capacity ? capacity : 1) * sizeof(Slot), hugePages),
+    _pSlots((Slot*)_buffer.data()),
+    _capacity(capacity ? capacity : 1),
+    _head(0),
+    _drained(0)
+  {
+    for (std::size_t i = 0; i < _capacity; i++)
+    {
+      new (&_pSlots[i]) Slot();
+      _pSlots[i].sequence.store(0, boost::memory_order_relaxed);
+      _pSlots[i].dropped.store(0, boost::memory_order_relaxed);
+    }
+  }
+  
+  FlightRecorder::~FlightRecorder()
+  {
+    for (std::size_t i = 0; i < _capacity; i++)
+      _pSlots[i].~Slot();
+  }
+  
+  void FlightRecorder::capture(int priority, const char* text, std::size_t length)
+  {
+    unsigned long long position = _head.fetch_add(1, boost::memory_order_relaxed);
+    Slot& slot = _pSlots[position % _capacity];
+    
+    //
+    // Sequence lock per slot.  An odd value tells readers the slot is
+    // being written.  The stable value encodes the ring position so a
+    // reader can tell a slot that was overwritten by a later lap.
+    //
+    // Writers a lap apart map to the same slot.  The slot is claimed by
+    // moving it from a stable value of an earlier lap to odd, and the
+    // record is dropped if another writer holds the slot or a later lap
+    // already wrote it.
+    //
+    unsigned long long sequence = slot.sequence.load(boost::memory_order_relaxed);
+    if ((sequence & 1) || sequence >= position * 2 + 2 ||
+      !slot.sequence.compare_exchange_strong(sequence, position * 2 + 1, boost::memory_order_relaxed))
+    {
+      //
+      // Tell drain() the position is lost rather than not written yet
+      //
+      unsigned long long dropped = slot.dropped.load(boost::memory_order_relaxed);
+      while (dropped < position + 1 && !slot.dropped.compare_exchange_weak(dropped, position + 1, boost::memory_order_release, boost::memory_order_relaxed))
+      {
+      }
+      return;
+    }
+    boost::atomic_thread_fence(boost::memory_order_release);
+    
+    if (length > sizeof(slot.text))
+      length = sizeof(slot.text);
+    
+    slot.ticks = Clock::ticks();
+    slot.priority = priority;
+    slot.length = length;
+    std::memcpy(slot.text, text, length);
+    
+    slot.sequence.store(position * 2 + 2, boost::memory_order_release);
+  }
+  
+  void FlightRecorder::drain(Records& records)
+  {
+    unsigned long long head = _head.load(boost::memory_order_acquire);
+    unsigned long long position = head > _capacity ? head - _capacity : 0;
+    if (position < _drained)
+      position = _drained;
+    
+    for (; position < head; position++)
+    {
+      const Slot& slot = _pSlots[position % _capacity];
+      unsigned long long sequence = slot.sequence.load(boost::memory_order_acquire);
+      if (sequence > position * 2 + 2)
+        continue; // overwritten by a later lap
+      
+      if (sequence < position * 2 + 2)
+      {
+        if (sequence != position * 2 + 1 && slot.dropped.load(boost::memory_order_acquire) > position)
+          continue; // dropped by its writer
+        
+        //
+        // Being written, or claimed by _head but not yet by the slot.
+        // Leave it and the records after it to the next drain.
+        //
+        break;
+      }
+      
+      Record record;
+      record.ticks = slot.ticks;
+      record.priority = slot.priority;
+      record.text.assign(slot.text, slot.length);
+      
+      boost::atomic_thread_fence(boost::memory_order_acquire);
+      if (slot.sequence.load(boost::memory_order_relaxed) != sequence)
+        continue; // overwritten while copying
+      
+      records.push_back(record);
+    }
+    
+    _drained = position;
+  }
+  
+} // swarm
@@ -0,0 +1,213 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <fnmatch.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <boost/thread/mutex.hpp>
+
+#include "swarm/LogCallSite.h"
+
+
+namespace swarm
+{
+  struct LogCallSiteRule
+  {
+    std::string pattern;
+    LogCallSite::State state;
+  };
+  
+  struct LogCallSiteTable
+  {
+    typedef std::vector<LogCallSite*> Sites;
+    typedef std::vector<LogCallSiteRule> Rules;
+    
+    boost::mutex mutex;
+    Sites sites;
+    Rules rules;
+  };
+  
+  static LogCallSiteTable& call_site_table()
+  {
+    //
+    // Call sites are statics spread across translation units.
+    // Construct the table on first use to be safe from the
+    // static initialization order.
+    //
+    static LogCallSiteTable* pTable = new LogCallSiteTable();
+    return *pTable;
+  }
+  
+  LogCallSite::LogCallSite(const char* file, int line, const char* function, int priority) :
+    _file(file),
+    _line(line),
+    _function(function),
+    _priority(priority),
+    _state(STATE_DEFAULT)
+  {
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    for (LogCallSiteTable::Rules::const_iterator iter = table.rules.begin(); iter != table.rules.end(); iter++)
+    {
+      if (matches(iter->pattern))
+        _state.store(iter->state, boost::memory_order_relaxed);
+    }
+    
+    table.sites.push_back(this);
+  }
+  
+  LogCallSite::~LogCallSite()
+  {
+    //
+    // The table is never destroyed, so sites of an unloaded library or
+    // destroyed during the process exit can still remove themselves
+    //
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    LogCallSiteTable::Sites::iterator iter = std::find(table.sites.begin(), table.sites.end(), this);
+    if (iter != table.sites.end())
+      table.sites.erase(iter);
+  }
+  
+  bool LogCallSite::matches(const std::string& pattern) const
+  {
+    if (fnmatch(pattern.c_str(), _function, 0) == 0)
+      return true;
+    
+    char location[1024];
+    std::snprintf(location, sizeof(location), "%s:%d", _file, _line);
+    if (fnmatch(pattern.c_str(), location, 0) == 0)
+      return true;
+    
+    const char* baseName = std::strrchr(location, '/');
+    return baseName && fnmatch(pattern.c_str(), baseName + 1, 0) == 0;
+  }
+  
+  std::size_t LogCallSite::setState(const std::string& pattern, State state)
+  {
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    //
+    // A rule for the same pattern is replaced.  It moves to the end so
+    // it still overrides the earlier rules like it does for the
+    // registered call sites.
+    //
+    for (LogCallSiteTable::Rules::iterator iter = table.rules.begin(); iter != table.rules.end(); iter++)
+    {
+      if (iter->pattern == pattern)
+      {
+        table.rules.erase(iter);
+        break;
+      }
+    }
+    
+    LogCallSiteRule rule;
+    rule.pattern = pattern;
+    rule.state = state;
+    table.rules.push_back(rule);
+    
+    std::size_t count = 0;
+    for (LogCallSiteTable::Sites::iterator iter = table.sites.begin(); iter != table.sites.end(); iter++)
+    {
+      if ((*iter)->matches(pattern))
+      {
+        (*iter)->_state.store(state, boost::memory_order_relaxed);
+        count++;
+      }
+    }
+    return count;
+  }
+  
+  void LogCallSite::resetState()
+  {
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    table.rules.clear();
+    for (LogCallSiteTable::Sites::iterator iter = table.sites.begin(); iter != table.sites.end(); iter++)
+      (*iter)->_state.store(STATE_DEFAULT, boost::memory_order_relaxed);
+  }
+  
+  bool LogCallSite::loadControlFile(const std::string& path)
+  {
+    std::ifstream file(path.c_str());
+    if (!file.is_open())
+      return false;
+    
+    //
+    // Parse everything before touching the table so that a reload
+    // never leaves the call sites half configured.
+    //
+    LogCallSiteTable::Rules rules;
+    std::string line;
+    while (std::getline(file, line))
+    {
+      std::istringstream strm(line);
+      std::string pattern;
+      std::string state;
+      if (!(strm >> pattern) || pattern[0] == '#' || !(strm >> state))
+        continue;
+      
+      LogCallSiteRule rule;
+      rule.pattern = pattern;
+      if (state == "on")
+        rule.state = STATE_ENABLED;
+      else if (state == "off")
+        rule.state = STATE_DISABLED;
+      else if (state == "default")
+        rule.state = STATE_DEFAULT;
+      else
+        continue;
+      
+      rules.push_back(rule);
+    }
+    
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    table.rules = rules;
+    for (LogCallSiteTable::Sites::iterator site = table.sites.begin(); site != table.sites.end(); site++)
+    {
+      State state = STATE_DEFAULT;
+      for (LogCallSiteTable::Rules::const_iterator iter = rules.begin(); iter != rules.end(); iter++)
+      {
+        if ((*site)->matches(iter->pattern))
+          state = iter->state;
+      }
+      (*site)->_state.store(state, boost::memory_order_relaxed);
+    }
+    
+    return true;
+  }
+  
+  void LogCallSite::getSites(Sites& sites)
+  {
+    LogCallSiteTable& table = call_site_table();
+    boost::mutex::scoped_lock lock(table.mutex);
+    
+    sites.assign(table.sites.begin(), table.sites.end());
+  }
+  
+} // swarm
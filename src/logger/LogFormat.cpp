@@ -0,0 +1,232 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstdio>
+
+#include "swarm/LogFormat.h"
+
+
+namespace swarm
+{
+  static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+  
+  static void append_unsigned(std::string& out, unsigned long long value, bool negative)
+  {
+    //
+    // Write two digits at a time from the end of a stack buffer
+    //
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    
+    while (value >= 100)
+    {
+      unsigned int pair = (unsigned int)(value % 100) * 2;
+      value /= 100;
+      *--p = DIGIT_PAIRS[pair + 1];
+      *--p = DIGIT_PAIRS[pair];
+    }
+    
+    if (value >= 10)
+    {
+      unsigned int pair = (unsigned int)value * 2;
+      *--p = DIGIT_PAIRS[pair + 1];
+      *--p = DIGIT_PAIRS[pair];
+    }
+    else
+    {
+      *--p = (char)('0' + value);
+    }
+    
+    if (negative)
+      *--p = '-';
+    
+    out.append(p, end - p);
+  }
+  
+  static void append_signed(std::string& out, long long value)
+  {
+    if (value < 0)
+      append_unsigned(out, 0ULL - (unsigned long long)value, true);
+    else
+      append_unsigned(out, (unsigned long long)value, false);
+  }
+  
+  void LogFormat::append(std::string& out, bool value)
+  {
+    //
+    // 1 or 0 like an ostream without boolalpha, so a call site moved
+    // from the SWARM_LOG_* macros writes the same text
+    //
+    out += value ? '1' : '0';
+  }
+  
+  void LogFormat::append(std::string& out, char value)
+  {
+    out.push_back(value);
+  }
+  
+  void LogFormat::append(std::string& out, signed char value)
+  {
+    out.push_back((char)value);
+  }
+  
+  void LogFormat::append(std::string& out, unsigned char value)
+  {
+    out.push_back((char)value);
+  }
+  
+  void LogFormat::append(std::string& out, short value)
+  {
+    append_signed(out, value);
+  }
+  
+  void LogFormat::append(std::string& out, unsigned short value)
+  {
+    append_unsigned(out, value, false);
+  }
+  
+  void LogFormat::append(std::string& out, int value)
+  {
+    append_signed(out, value);
+  }
+  
+  void LogFormat::append(std::string& out, unsigned int value)
+  {
+    append_unsigned(out, value, false);
+  }
+  
+  void LogFormat::append(std::string& out, long value)
+  {
+    append_signed(out, value);
+  }
+  
+  void LogFormat::append(std::string& out, unsigned long value)
+  {
+    append_unsigned(out, value, false);
+  }
+  
+  void LogFormat::append(std::string& out, long long value)
+  {
+    append_signed(out, value);
+  }
+  
+  void LogFormat::append(std::string& out, unsigned long long value)
+  {
+    append_unsigned(out, value, false);
+  }
+  
+  void LogFormat::append(std::string& out, float value)
+  {
+    append(out, (double)value);
+  }
+  
+  void LogFormat::append(std::string& out, double value)
+  {
+    //
+    // %g matches the default precision of the ostream based macros
+    //
+    char buf[32];
+    int len = std::snprintf(buf, sizeof(buf), "%g", value);
+    if (len > 0)
+      out.append(buf, (std::size_t)len < sizeof(buf) ? len : sizeof(buf) - 1);
+  }
+  
+  void LogFormat::append(std::string& out, const char* value)
+  {
+    if (value)
+      out.append(value);
+    else
+      out.append("(null)", 6);
+  }
+  
+  void LogFormat::append(std::string& out, char* value)
+  {
+    append(out, (const char*)value);
+  }
+  
+  void LogFormat::append(std::string& out, const std::string& value)
+  {
+    out.append(value);
+  }
+  
+  void LogFormat::append(std::string& out, const void* value)
+  {
+    static const char HEX[] = "0123456789abcdef";
+    char buf[2 + 2 * sizeof(void*)];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    
+    unsigned long long address = (unsigned long long)(std::size_t)value;
+    do
+    {
+      *--p = HEX[address & 0xf];
+      address >>= 4;
+    } while (address);
+    *--p = 'x';
+    *--p = '0';
+    
+    out.append(p, end - p);
+  }
+  
+  bool LogFormat::appendLiteral(std::string& out, const char*& format)
+  {
+    const char* start = format;
+    for (;;)
+    {
+      char c = *format;
+      if (!c)
+      {
+        out.append(start, format - start);
+        return false;
+      }
+      
+      if ((c == '{' || c == '}') && format[1] == c)
+      {
+        //
+        // Escaped brace.  Keep one of the two.
+        //
+        out.append(start, format - start + 1);
+        format += 2;
+        start = format;
+      }
+      else if (c == '{' && format[1] == '}')
+      {
+        out.append(start, format - start);
+        format += 2;
+        return true;
+      }
+      else
+      {
+        format++;
+      }
+    }
+  }
+  
+} // swarm
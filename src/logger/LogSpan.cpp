@@ -0,0 +1,62 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+
+#include <cstdio>
+
+#include "swarm/LogSpan.h"
+
+namespace swarm
+{
+  
+  LogSpan::~LogSpan()
+  {
+    if (!_start)
+      return;
+    
+    unsigned long long duration = Clock::nanoseconds(Clock::ticks() - _start);
+    
+    bool slow = _threshold && duration >= _threshold;
+    if (!slow && !_enabled)
+      return;
+    
+    Logger::Priority priority = slow ? Logger::PRIO_WARNING : _priority;
+    
+    if (!_pLogger->willLog(priority))
+      return;
+    
+    //
+    // Format without an ostringstream.  The span name is expected
+    // to be a short static string so a stack buffer is enough.
+    //
+    char buf[256];
+    int len = std::snprintf(buf, sizeof(buf), "%s elapsed %llu.%03llu us%s",
+      _name,
+      duration / 1000,
+      duration % 1000,
+      slow ? " (slow)" : "");
+    
+    if (len < 0)
+      return;
+    if ((std::size_t)len >= sizeof(buf))
+      len = sizeof(buf) - 1;
+    
+    _pLogger->log(priority, std::string(buf, len));
+  }
+  
+} // swarm
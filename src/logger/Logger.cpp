@@ -23,17 +23,25 @@
 #include "Poco/SplitterChannel.h"
 #include "Poco/FileChannel.h"
 #include "Poco/PatternFormatter.h"
-#include "Poco/FormattingChannel.h"
 #include "Poco/Message.h"
-#include "Poco/Logger.h"
 #include "Poco/Timestamp.h"
-#include "Poco/LogStream.h"
+#include "Poco/Thread.h"
 #include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
+#include <boost/bind.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/filesystem/operations.hpp>
 
 #include "swarm/Logger.h"
+#include "swarm/AppendChannel.h"
+#include "swarm/Clock.h"
+#include "swarm/Exception.h"
+#include "swarm/ExceptionStats.h"
+#include "swarm/FlightRecorder.h"
 
 namespace swarm
 {
@@ -43,6 +51,8 @@ namespace swarm
   static const Logger::Priority LOGGER_DEFAULT_PRIORITY = Logger::PRIO_INFORMATION;
   static const unsigned int LOGGER_DEFAULT_PURGE_COUNT = 0; /// Disable log rotatepoco
   static unsigned int DEFAULT_VERIFY_TTL = 5; /// TTL in seconds for verification to kick in
+  static const std::size_t LOGGER_FORMAT_BUFFER_SIZE = 1024; /// Initial size of the per-thread format buffer
+  static const std::size_t LOGGER_RECORD_BUFFER_SIZE = 4096; /// Initial size of the logger record buffers
 
   Logger* Logger::_pLoggerInstance = 0;
   
@@ -89,13 +99,189 @@ namespace swarm
     assert(false);
   }
     
+  //
+  // Everything needed to turn a log call into a line in the file.  The
+  // messages and strings are reused for every record so that, once they
+  // have grown to the size of the longest record, writing a record does
+  // not allocate.  Access is serialized by the logger mutex.
+  //
+  struct Logger::Subscription
+  {
+    SubscriptionId id;
+    Subscriber subscriber;
+    Priority priority;  /// Lowest priority delivered
+    long long budget;  /// Writer time allowed per second in nanoseconds.  0 if unlimited
+    long long credit;  /// Writer time left in nanoseconds
+    Clock::Ticks refilled;  /// Time the credit was last topped up
+    unsigned long long dropped;  /// Records skipped while over budget
+    
+    void deliver(Priority recordPriority, const std::string& record)
+    {
+      if (recordPriority > priority)
+        return;
+      
+      Clock::Ticks now = 0;
+      if (budget)
+      {
+        //
+        // Top up the credit for the time elapsed, at most a second's worth
+        //
+        now = Clock::ticks();
+        unsigned long long elapsed = Clock::nanoseconds(now - refilled);
+        refilled = now;
+        credit = elapsed >= 1000000000ULL ? budget : std::min(budget, credit + (long long)(elapsed * budget / 1000000000LL));
+        if (credit <= 0)
+        {
+          dropped++;
+          return;
+        }
+      }
+      
+      try
+      {
+        subscriber(recordPriority, record.data(), record.size());
+      }
+      catch (...)
+      {
+      }
+      
+      if (budget)
+        credit -= (long long)Clock::nanoseconds(Clock::ticks() - now);
+    }
+  };
+  
+  struct Logger::Pipeline
+  {
+    Poco::AutoPtr<Poco::Formatter> formatter;
+    Poco::AutoPtr<Poco::Channel> channel;
+    AppendChannel* pAppendChannel;  /// channel in SINK_APPEND mode, null otherwise
+    Poco::Message message;  /// The record handed to the formatter
+    Poco::Message rendered;  /// The formatted record handed to the channel
+    std::string text;  /// Staging copy of the message text
+    std::string record;  /// The formatted record
+    bool threadName;  /// The format prints the thread name (%T)
+    const Subscriptions& subscriptions;  /// Observers of the formatted records
+    
+    Pipeline(
+      const Logger& logger,
+      const std::string& path,
+      const std::string& format,
+      unsigned int purgeCount
+    ) :
+      formatter(new Poco::PatternFormatter(format.c_str())),
+      pAppendChannel(0),
+      threadName(format.find("%T") != std::string::npos),
+      subscriptions(logger._subscriptions)
+    {
+      text.reserve(LOGGER_RECORD_BUFFER_SIZE);
+      record.reserve(LOGGER_RECORD_BUFFER_SIZE);
+      
+      if (logger._sinkMode == SINK_APPEND)
+      {
+        pAppendChannel = new AppendChannel(path);
+        channel = pAppendChannel;
+        pAppendChannel->setMaxRecordSize(logger._maxRecordSize);
+        pAppendChannel->setPreallocation(logger._preallocation);
+        pAppendChannel->enableDropCache(logger._dropCache);
+        pAppendChannel->open();
+        return;
+      }
+      
+      channel = new Poco::FileChannel(path);
+      
+      if (purgeCount > 0)
+      {
+        channel->setProperty("rotation", "daily");
+        channel->setProperty("archive", "timestamp");
+        channel->setProperty("compress", "true");
+        channel->setProperty("purgeCount", boost::lexical_cast<std::string>(purgeCount));
+      }
+    }
+    
+    void write(Poco::Message::Priority priority, const char* log, std::size_t length, const Poco::Timestamp& time)
+    {
+      //
+      // Poco::Message fills in the thread when it is constructed.  The
+      // reused message has to be updated by hand.
+      //
+      Poco::Thread* pThread = Poco::Thread::current();
+      message.setTid(pThread ? pThread->id() : 0);
+      if (threadName)
+        message.setThread(pThread ? pThread->getName() : std::string());
+      
+      text.assign(log, length);
+      message.setText(text);
+      message.setPriority(priority);
+      message.setTime(time);
+      
+      record.clear();
+      formatter->format(message, record);
+      
+      //
+      // Publish before the sink, AppendChannel terminates the record in place
+      //
+      for (Subscriptions::const_iterator iter = subscriptions.begin(); iter != subscriptions.end(); iter++)
+        (*iter)->deliver((Priority)priority, record);
+      
+      if (pAppendChannel)
+      {
+        pAppendChannel->write(record);
+        return;
+      }
+      
+      rendered.setText(record);
+      rendered.setPriority(priority);
+      rendered.setTime(time);
+      channel->log(rendered);
+    }
+    
+    void write(Poco::Message::Priority priority, const char* log, std::size_t length)
+    {
+      //
+      // Without the TSC a tick conversion costs more clock reads than the
+      // single one of Poco::Timestamp
+      //
+      if (!Clock::isTscEnabled())
+      {
+        write(priority, log, length, Poco::Timestamp());
+        return;
+      }
+      
+      write(priority, log, length, Poco::Timestamp((Poco::Timestamp::TimeVal)(Clock::realtime(Clock::ticks()) / 1000)));
+    }
+    
+    void setSource(const std::string& source)
+    {
+      message.setSource(source);
+      rendered.setSource(source);
+    }
+  };
+    
   Logger::Logger(const std::string& name) :
     _name(name),
+    _purgeCount(LOGGER_DEFAULT_PURGE_COUNT),
+    _priority(LOGGER_DEFAULT_PRIORITY),
     _instanceCount(0),
     _lastVerifyTime(0),
     _enableVerification(true),
     _verificationInterval(DEFAULT_VERIFY_TTL),
-    _isOpen(false)
+    _isOpen(false),
+    _pPipeline(0),
+    _pFlightRecorder(0),
+    _flightRecorderPriority(PRIO_TRACE),
+    _enableHugePages(false),
+    _sinkMode(SINK_FILE),
+    _maxRecordSize(AppendChannel::DEFAULT_MAX_RECORD_SIZE),
+    _durablePriority(0),
+    _syncWindow(0),
+    _preallocation(0),
+    _dropCache(false),
+    _watching(false),
+    _pWatcher(0),
+    _stopWatcher(false),
+    _threadOptionsVersion(0),
+    _lastSubscriptionId(0),
+    _exceptionLogHook(0)
   {
     std::ostringstream strm;
     strm << _name << "-" << _instanceCount;
@@ -104,12 +290,23 @@ namespace swarm
 
   Logger::~Logger()
   {
+    stopWatcher();
+    disableExceptionLog();
+    
     //
     // Grab the mutex before calling close to make sure we do not corrupt
     // any pointers within the current executing log message
     //
+    ExceptionStats::LogGuard guard;
     mutex_lock lock(_mutex);
     close();
+    
+    delete _pFlightRecorder;
+    _pFlightRecorder = 0;
+    
+    for (Subscriptions::iterator iter = _subscriptions.begin(); iter != _subscriptions.end(); iter++)
+      delete *iter;
+    _subscriptions.clear();
   }
 
 
@@ -150,50 +347,38 @@ namespace swarm
       return false;
     }
     
+    //
+    // open() may run with the mutex held.  Exceptions caught here must
+    // not be logged back through this logger.
+    //
+    ExceptionStats::LogGuard guard;
+    
     try
     {
       _path = path;
       _priority = priority;
       _format = format;
       _purgeCount = purgeCount;
-
-      bool enableLogRotate = LOGGER_DEFAULT_PURGE_COUNT > 0;
-      std::string strPurgeCount = boost::lexical_cast<std::string>(purgeCount);
-      Poco::AutoPtr<Poco::FileChannel> fileChannel(new Poco::FileChannel(path));
-
-      if (enableLogRotate)
-      {
-        fileChannel->setProperty("rotation", "daily");
-        fileChannel->setProperty("archive", "timestamp");
-        fileChannel->setProperty("compress", "true");
-        fileChannel->setProperty("purgeCount", strPurgeCount);
-      }
+      _pPipeline = new Pipeline(*this, path, format, purgeCount);
 
       //
       // increment the instance name so that we use a 
-      // new logger instance when we open/reopen the channel
+      // new source name when we open/reopen the channel
       //
       std::ostringstream strmName;
       strmName << _name << "-" << ++_instanceCount;
       _internalName = strmName.str();
+      _pPipeline->setSource(_internalName);
       
-      Poco::AutoPtr<Poco::Formatter> formatter(new Poco::PatternFormatter(format.c_str()));
-      Poco::AutoPtr<Poco::Channel> formattingChannel(new Poco::FormattingChannel(formatter, fileChannel));
-      Poco::Logger::create(_internalName, formattingChannel, poco_priority(priority));
+      _lastError = "";
+      _isOpen = true;
       
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
-      {
-        Poco::LogStream logStrm(*pLogger);
-        logStrm.notice() << "Logger::open(" << _internalName << ") path: " << _path << std::endl;
-          
-        _lastError = "";
-        _isOpen = true;
-      }
-      else
+      if (willLog(PRIO_NOTICE))
       {
-        _lastError = "Logger::open - Poco::Logger is null";
-        _isOpen = false;
+        std::ostringstream strm;
+        strm << "Logger::open(" << _internalName << ") path: " << _path;
+        std::string notice = strm.str();
+        _pPipeline->write(Poco::Message::PRIO_NOTICE, notice.data(), notice.size());
       }
     }
     catch(const std::exception& e)
@@ -212,23 +397,137 @@ namespace swarm
     
     return _isOpen;
   }
+  
+  bool Logger::reload(
+    const std::string& path,  
+    Priority priority,
+    const std::string& format, 
+    unsigned int purgeCount 
+  )
+  {
+    //
+    // Build the new pipeline without holding the mutex.  Logging threads
+    // keep writing to the current pipeline in the meantime.
+    //
+    const std::string& channelFormat = format.empty() ? LOGGER_DEFAULT_FORMAT : format;
+    Pipeline* pPipeline = 0;
+    try
+    {
+      pPipeline = new Pipeline(*this, path, channelFormat, purgeCount);
+    }
+    catch(const std::exception& e)
+    {
+      mutex_lock lock(_mutex);
+      _lastError = "Logger::reload - ";
+      _lastError += e.what();
+      return false;
+    }
+    catch(...)
+    {
+      mutex_lock lock(_mutex);
+      _lastError = "Logger::reload unknown exception";
+      return false;
+    }
+    
+    Pipeline* pOldPipeline = 0;
+    std::string internalName;
+    {
+      //
+      // Every write holds the mutex for the duration of the write so a
+      // message goes either to the old or to the new pipeline, never both.
+      //
+      mutex_lock lock(_mutex);
+      
+      std::ostringstream strmName;
+      strmName << _name << "-" << ++_instanceCount;
+      
+      pOldPipeline = _pPipeline;
+      _pPipeline = pPipeline;
+      _internalName = strmName.str();
+      _pPipeline->setSource(_internalName);
+      _path = path;
+      _priority = priority;
+      _format = channelFormat;
+      _purgeCount = purgeCount;
+      _lastError = "";
+      _isOpen = true;
+      internalName = _internalName;
+    }
+    
+    //
+    // Nobody references the old pipeline past the swap.  Flush and
+    // close it outside of the mutex.
+    //
+    if (pOldPipeline)
+    {
+      pOldPipeline->channel->close();
+      delete pOldPipeline;
+    }
+    
+    if (willLog(PRIO_NOTICE))
+    {
+      std::ostringstream strm;
+      strm << "Logger::reload(" << internalName << ") path: " << path;
+      notice(strm.str());
+    }
+    
+    return true;
+  }
 
   void Logger::close()
   {
-    if (Poco::Logger::has(_internalName))
-      Poco::Logger::destroy(_internalName);
+    if (_pPipeline)
+    {
+      _pPipeline->channel->close();
+      delete _pPipeline;
+      _pPipeline = 0;
+    }
     
-    _isOpen = Poco::Logger::has(_internalName);
+    _isOpen = false;
   }
  
   void Logger::setPriority(Logger::Priority priority)
   {
     _priority = priority;
-    Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-    if (pLogger)
+  }
+  
+  Logger::Priority Logger::parsePriority(const std::string& priority, Priority defaultPriority)
+  {
+    static const char* priorityNames[] =
+    {
+      "fatal", "critical", "error", "warning", "notice", "information", "debug", "trace"
+    };
+    
+    std::string name(priority);
+    for (std::string::iterator iter = name.begin(); iter != name.end(); iter++)
+      *iter = std::tolower(*iter);
+    
+    if (name == "info")
+      return PRIO_INFORMATION;
+    
+    for (int i = 0; i < 8; i++)
     {
-      pLogger->setLevel(poco_priority(priority));
+      if (name == priorityNames[i])
+        return (Priority)(PRIO_FATAL + i);
     }
+    
+    int value = std::atoi(name.c_str());
+    if (value >= PRIO_FATAL && value <= PRIO_TRACE)
+      return (Priority)value;
+    
+    return defaultPriority;
+  }
+  
+  bool Logger::parseSinkMode(const std::string& mode, SinkMode& result)
+  {
+    if (mode == "file")
+      result = SINK_FILE;
+    else if (mode == "append")
+      result = SINK_APPEND;
+    else
+      return false;
+    
+    return true;
   }
   
   bool Logger::willLog(Priority priority) const
@@ -238,169 +537,586 @@ namespace swarm
 
   void Logger::fatal(const std::string& log)
   {
-    //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
-    //
-    mutex_lock lock(_mutex);
+    dispatch(PRIO_FATAL, log.data(), log.size());
+  }
+  
+  void Logger::fatal(const char* log)
+  {
+    dispatch(PRIO_FATAL, log, std::strlen(log));
+  }
+  
+  void Logger::fatal(boost::string_ref log)
+  {
+    dispatch(PRIO_FATAL, log.data(), log.size());
+  }
+
+  void Logger::critical(const std::string& log)
+  {
+    dispatch(PRIO_CRITICAL, log.data(), log.size());
+  }
+  
+  void Logger::critical(const char* log)
+  {
+    dispatch(PRIO_CRITICAL, log, std::strlen(log));
+  }
+  
+  void Logger::critical(boost::string_ref log)
+  {
+    dispatch(PRIO_CRITICAL, log.data(), log.size());
+  }
+
+  void Logger::error(const std::string& log)
+  {
+    dispatch(PRIO_ERROR, log.data(), log.size());
+  }
+  
+  void Logger::error(const char* log)
+  {
+    dispatch(PRIO_ERROR, log, std::strlen(log));
+  }
+  
+  void Logger::error(boost::string_ref log)
+  {
+    dispatch(PRIO_ERROR, log.data(), log.size());
+  }
+
+  void Logger::warning(const std::string& log)
+  {
+    dispatch(PRIO_WARNING, log.data(), log.size());
+  }
+  
+  void Logger::warning(const char* log)
+  {
+    dispatch(PRIO_WARNING, log, std::strlen(log));
+  }
+  
+  void Logger::warning(boost::string_ref log)
+  {
+    dispatch(PRIO_WARNING, log.data(), log.size());
+  }
+
+  void Logger::notice(const std::string& log)
+  {
+    dispatch(PRIO_NOTICE, log.data(), log.size());
+  }
+  
+  void Logger::notice(const char* log)
+  {
+    dispatch(PRIO_NOTICE, log, std::strlen(log));
+  }
+  
+  void Logger::notice(boost::string_ref log)
+  {
+    dispatch(PRIO_NOTICE, log.data(), log.size());
+  }
+
+  void Logger::information(const std::string& log)
+  {
+    dispatch(PRIO_INFORMATION, log.data(), log.size());
+  }
+  
+  void Logger::information(const char* log)
+  {
+    dispatch(PRIO_INFORMATION, log, std::strlen(log));
+  }
+  
+  void Logger::information(boost::string_ref log)
+  {
+    dispatch(PRIO_INFORMATION, log.data(), log.size());
+  }
+
+  void Logger::debug(const std::string& log)
+  {
+    dispatch(PRIO_DEBUG, log.data(), log.size());
+  }
+  
+  void Logger::debug(const char* log)
+  {
+    dispatch(PRIO_DEBUG, log, std::strlen(log));
+  }
+  
+  void Logger::debug(boost::string_ref log)
+  {
+    dispatch(PRIO_DEBUG, log.data(), log.size());
+  }
+
+  void Logger::trace(const std::string& log)
+  {
+    dispatch(PRIO_TRACE, log.data(), log.size());
+  }
+  
+  void Logger::trace(const char* log)
+  {
+    dispatch(PRIO_TRACE, log, std::strlen(log));
+  }
+  
+  void Logger::trace(boost::string_ref log)
+  {
+    dispatch(PRIO_TRACE, log.data(), log.size());
+  }
+
+  void Logger::log(Priority priority, const std::string& log)
+  {
+    dispatch(priority, log.data(), log.size());
+  }
+  
+  void Logger::log(Priority priority, const char* log)
+  {
+    dispatch(priority, log, std::strlen(log));
+  }
+  
+  void Logger::log(Priority priority, boost::string_ref log)
+  {
+    dispatch(priority, log.data(), log.size());
+  }
+  
+  void Logger::log(const LogCallSite& site, const std::string& log)
+  {
+    Priority priority = (Priority)site.priority();
     
-    if (willLog(PRIO_FATAL) && (_enableVerification ? verifyLogFile(false) : isOpen()) )
+    switch (site.getState())
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
-      {
-        pLogger->fatal(log);
-      }
+      case LogCallSite::STATE_DISABLED:
+        return;
+      case LogCallSite::STATE_ENABLED:
+        if (!willLog(priority))
+        {
+          write(priority, log.data(), log.size());
+          return;
+        }
+        break;
+      default:
+        break;
     }
+    
+    dispatch(priority, log.data(), log.size());
   }
-
-  void Logger::critical(const std::string& log)
+  
+  void Logger::dispatch(Priority priority, const char* log, std::size_t length)
+  {
+    if (!willLog(priority))
+    {
+      record(priority, log, length);
+      return;
+    }
+    
+    write(priority, log, length);
+  }
+  
+  void Logger::write(Priority priority, const char* log, std::size_t length)
   {
     //
     // We need to make this thread safe or calls from 
     // different thread might try to reopen the logger
     // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
+    // This can result to a segmentation fault if the channel
     // is released from another thread
     //
-    mutex_lock lock(_mutex);
-    
-    if (willLog(PRIO_CRITICAL) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    Poco::AutoPtr<AppendChannel> pDurableChannel;
+    unsigned long long durableRecords = 0;
+    unsigned int syncWindow = 0;
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
+      //
+      // Exceptions that end while the mutex is held, e.g. thrown by a
+      // subscriber, must not be logged back through this logger
+      //
+      ExceptionStats::LogGuard guard;
+      mutex_lock lock(_mutex);
+      
+      if (!isWritable())
+        return;
+      
+      //
+      // Write the suppressed context that led to an error first
+      //
+      if (_pFlightRecorder && priority <= PRIO_ERROR)
+        flushFlightRecorder();
+      
+      _pPipeline->write(poco_priority(priority), log, length);
+      
+      if (priority <= _durablePriority && _pPipeline->pAppendChannel)
       {
-        pLogger->critical(log);
+        //
+        // Keep a reference so the channel outlives a concurrent reload
+        //
+        pDurableChannel = Poco::AutoPtr<AppendChannel>(_pPipeline->pAppendChannel, true);
+        durableRecords = pDurableChannel->written();
+        syncWindow = _syncWindow;
       }
     }
-  }
-
-  void Logger::error(const std::string& log)
-  {
+    
     //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
+    // Wait for the group commit without holding up other writers
     //
-    mutex_lock lock(_mutex);
+    if (durableRecords)
+      pDurableChannel->sync(durableRecords, syncWindow);
+  }
+  
+  Logger::SubscriptionId Logger::subscribe(const Subscriber& subscriber, Priority priority, unsigned int budgetMicroseconds)
+  {
+    Subscription* pSubscription = new Subscription();
+    pSubscription->subscriber = subscriber;
+    pSubscription->priority = priority;
+    pSubscription->budget = (long long)std::min(budgetMicroseconds, 1000000U) * 1000;
+    pSubscription->credit = pSubscription->budget;
+    pSubscription->refilled = Clock::ticks();
+    pSubscription->dropped = 0;
     
-    if (willLog(PRIO_ERROR) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    mutex_lock lock(_mutex);
+    pSubscription->id = ++_lastSubscriptionId;
+    _subscriptions.push_back(pSubscription);
+    return pSubscription->id;
+  }
+  
+  bool Logger::unsubscribe(SubscriptionId id)
+  {
+    Subscription* pSubscription = 0;
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
+      mutex_lock lock(_mutex);
+      for (Subscriptions::iterator iter = _subscriptions.begin(); iter != _subscriptions.end(); iter++)
       {
-        pLogger->error(log);
+        if ((*iter)->id == id)
+        {
+          pSubscription = *iter;
+          _subscriptions.erase(iter);
+          break;
+        }
       }
     }
-  }
-
-  void Logger::warning(const std::string& log)
-  {
+    
     //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
+    // The subscriber may own resources, release it outside the lock
     //
+    delete pSubscription;
+    return pSubscription != 0;
+  }
+  
+  unsigned long long Logger::getDroppedRecords(SubscriptionId id)
+  {
     mutex_lock lock(_mutex);
+    for (Subscriptions::const_iterator iter = _subscriptions.begin(); iter != _subscriptions.end(); iter++)
+    {
+      if ((*iter)->id == id)
+        return (*iter)->dropped;
+    }
+    return 0;
+  }
+  
+  void Logger::log(Priority priority, const std::exception& exc)
+  {
+    if (!willFormat(priority))
+      return;
     
-    if (willLog(PRIO_WARNING) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    std::string& buffer = formatBuffer();
+    buffer.clear();
+    formatException(buffer, exc);
+    dispatch(priority, buffer.data(), buffer.size());
+  }
+  
+  void Logger::log(const LogCallSite& site, const std::exception& exc)
+  {
+    if (!willLog(site))
+      return;
+    
+    std::string& buffer = formatBuffer();
+    buffer.clear();
+    formatException(buffer, exc);
+    log(site, buffer);
+  }
+  
+  void Logger::formatException(std::string& out, const std::exception& exc)
+  {
+    const Exception* pException = dynamic_cast<const Exception*>(&exc);
+    if (!pException)
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
+      out.append(exc.what());
+      return;
+    }
+    
+    for (; pException; pException = pException->nested())
+    {
+      out.append(pException->name());
+      
+      const std::string& message = pException->message();
+      if (!message.empty())
       {
-        pLogger->warning(log);
+        out.append(": ");
+        out.append(message);
       }
+      
+      if (pException->code())
+      {
+        out.append(" [code ");
+        LogFormat::append(out, pException->code());
+        out.append("]");
+      }
+      
+      if (pException->nested())
+        out.append(", caused by ");
     }
   }
-
-  void Logger::notice(const std::string& log)
+  
+  void Logger::enableExceptionLog(Priority priority)
   {
+    ExceptionStats::enable(true);
+    _exceptionLogHook = ExceptionStats::setLogHook(boost::bind(&Logger::logException, this, priority, _1));
+  }
+  
+  void Logger::disableExceptionLog()
+  {
+    if (!_exceptionLogHook)
+      return;
+    
     //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
+    // Leave a hook installed since by another logger alone
     //
+    ExceptionStats::clearLogHook(_exceptionLogHook);
+    _exceptionLogHook = 0;
+  }
+  
+  void Logger::logException(Priority priority, const std::string& text)
+  {
+    log(priority, text);
+  }
+  
+  void Logger::enableDurability(Priority priority, unsigned int windowMicroseconds)
+  {
     mutex_lock lock(_mutex);
+    _durablePriority = priority;
+    _syncWindow = windowMicroseconds;
+  }
+  
+  void Logger::disableDurability()
+  {
+    mutex_lock lock(_mutex);
+    _durablePriority = 0;
+  }
+  
+  std::string& Logger::formatBuffer()
+  {
+    static boost::thread_specific_ptr<std::string> buffer;
     
-    if (willLog(PRIO_NOTICE) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    std::string* pBuffer = buffer.get();
+    if (!pBuffer)
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
-      {
-        pLogger->notice(log);
-      }
+      pBuffer = new std::string();
+      pBuffer->reserve(LOGGER_FORMAT_BUFFER_SIZE);
+      buffer.reset(pBuffer);
     }
+    return *pBuffer;
   }
-
-  void Logger::information(const std::string& log)
+  
+  void Logger::enableFlightRecorder(std::size_t records, Priority priority)
   {
-    //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
-    //
     mutex_lock lock(_mutex);
     
-    if (willLog(PRIO_INFORMATION) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    if (_pFlightRecorder)
+      return;
+    
+    _flightRecorderPriority = priority;
+    _pFlightRecorder = new FlightRecorder(records, _enableHugePages);
+  }
+  
+  void Logger::dumpFlightRecorder()
+  {
+    ExceptionStats::LogGuard guard;
+    mutex_lock lock(_mutex);
+    
+    if (_pFlightRecorder && isWritable())
+      flushFlightRecorder();
+  }
+  
+  Logger::Stats Logger::getStats() const
+  {
+    Stats stats;
+    stats.bufferBytes = 0;
+    stats.hugePageBytes = 0;
+    stats.transparentHugePageBytes = 0;
+    
+    if (_pFlightRecorder)
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
-      {
-        pLogger->information(log);
-      }
+      const MappedBuffer& buffer = _pFlightRecorder->buffer();
+      stats.bufferBytes += buffer.mappedSize();
+      if (buffer.backing() == MappedBuffer::BACKING_HUGE_PAGES)
+        stats.hugePageBytes += buffer.mappedSize();
+      else if (buffer.backing() == MappedBuffer::BACKING_TRANSPARENT_HUGE_PAGES)
+        stats.transparentHugePageBytes += buffer.mappedSize();
     }
+    
+    return stats;
   }
-
-  void Logger::debug(const std::string& log)
+  
+  void Logger::record(Priority priority, const char* log, std::size_t length)
   {
-    //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
-    //
+    if (_pFlightRecorder && priority <= _flightRecorderPriority)
+      _pFlightRecorder->capture(priority, log, length);
+  }
+  
+  void Logger::flushFlightRecorder()
+  {
+    static const char* priorityNames[] =
+    {
+      "", "FATAL", "CRITICAL", "ERROR", "WARNING", "NOTICE", "INFORMATION", "DEBUG", "TRACE"
+    };
+    
+    FlightRecorder::Records records;
+    _pFlightRecorder->drain(records);
+    
+    std::string text;
+    for (FlightRecorder::Records::const_iterator iter = records.begin(); iter != records.end(); iter++)
+    {
+      text = "[flight-recorder ";
+      text += priorityNames[iter->priority];
+      text += "] ";
+      text += iter->text;
+      
+      //
+      // The capture time is only converted to wall time here
+      //
+      _pPipeline->write(poco_priority((Priority)iter->priority), text.data(), text.size(),
+        Poco::Timestamp((Poco::Timestamp::TimeVal)(Clock::realtime(iter->ticks) / 1000)));
+    }
+  }
+  
+  bool Logger::isWritable()
+  {
+    if (_enableVerification && !_watching)
+      return verifyLogFile(false);
+    
+    return isOpen();
+  }
+  
+  bool Logger::startWatcher()
+  {
+    mutex_lock threadLock(_threadMutex);
+    
+    if (_pWatcher)
+      return false;
+    
+    _stopWatcher = false;
+    try
+    {
+      _pWatcher = new boost::thread(boost::bind(&Logger::runWatcher, this));
+    }
+    catch(const boost::thread_resource_error& e)
+    {
+      mutex_lock lock(_mutex);
+      _lastError = "Logger::startWatcher - ";
+      _lastError += e.what();
+      return false;
+    }
+    
     mutex_lock lock(_mutex);
+    _watching = true;
+    return true;
+  }
+  
+  void Logger::stopWatcher()
+  {
+    boost::thread* pWatcher = 0;
+    {
+      mutex_lock threadLock(_threadMutex);
+      pWatcher = _pWatcher;
+      _pWatcher = 0;
+      _stopWatcher = true;
+      _effectiveThreadOptions = ThreadOptions();
+    }
+    
+    if (!pWatcher)
+      return;
+    
+    _threadCondition.notify_all();
+    pWatcher->join();
+    delete pWatcher;
     
-    if (willLog(PRIO_DEBUG) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    mutex_lock lock(_mutex);
+    _watching = false;
+  }
+  
+  void Logger::setThreadOptions(const ThreadOptions& options)
+  {
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
-      {
-        pLogger->debug(log);
-      }
+      mutex_lock threadLock(_threadMutex);
+      _threadOptions = options;
+      _threadOptionsVersion++;
     }
+    _threadCondition.notify_all();
   }
-
-  void Logger::trace(const std::string& log)
+  
+  ThreadOptions Logger::getThreadOptions() const
   {
+    mutex_lock threadLock(_threadMutex);
+    return _threadOptions;
+  }
+  
+  ThreadOptions Logger::getEffectiveThreadOptions() const
+  {
+    mutex_lock threadLock(_threadMutex);
+    return _effectiveThreadOptions;
+  }
+  
+  void Logger::applyThreadOptions(const ThreadOptions& options)
+  {
+    std::string error;
+    if (!options.apply(error))
+      warning("Logger::applyThreadOptions(" + options.toString() + ") - " + error);
+    
+    ThreadOptions effective = ThreadOptions::current();
+    {
+      mutex_lock threadLock(_threadMutex);
+      if (!_stopWatcher)
+        _effectiveThreadOptions = effective;
+    }
+    
+    notice("Logger::watcher thread " + effective.toString());
+  }
+  
+  void Logger::runWatcher()
+  {
+    boost::unique_lock<mutex> threadLock(_threadMutex);
+    
     //
-    // We need to make this thread safe or calls from 
-    // different thread might try to reopen the logger
-    // at the same time when calling verifyLogFile.
-    // This can result to a segmentation fault if pLogger
-    // is released from another thread
+    // Apply the options as soon as the thread starts
     //
-    mutex_lock lock(_mutex);
+    unsigned int appliedVersion = _threadOptionsVersion - 1;
     
-    if (willLog(PRIO_TRACE) && (_enableVerification ? verifyLogFile(false) : isOpen()))
+    while (!_stopWatcher)
     {
-      Poco::Logger* pLogger = Poco::Logger::has(_internalName);
-      if (pLogger)
+      if (appliedVersion != _threadOptionsVersion)
+      {
+        appliedVersion = _threadOptionsVersion;
+        ThreadOptions options = _threadOptions;
+        threadLock.unlock();
+        applyThreadOptions(options);
+        threadLock.lock();
+        continue;
+      }
+      
+      threadLock.unlock();
+      
+      //
+      // Check the file without holding the logger mutex.  Writers are
+      // only held up if the file is gone and has to be reopened.
+      //
+      std::string path;
+      bool verify;
       {
-        pLogger->trace(log);
+        mutex_lock lock(_mutex);
+        path = _path;
+        verify = _enableVerification && _isOpen;
       }
+      
+      boost::system::error_code ec;
+      if (verify && !path.empty() && boost::filesystem::status(path, ec).type() == boost::filesystem::file_not_found)
+      {
+        ExceptionStats::LogGuard guard;
+        mutex_lock lock(_mutex);
+        verifyLogFile(true);
+      }
+      
+      threadLock.lock();
+      if (!_stopWatcher && appliedVersion == _threadOptionsVersion)
+        _threadCondition.timed_wait(threadLock, boost::posix_time::seconds(_verificationInterval));
     }
   }
   
@@ -414,8 +1130,11 @@ namespace swarm
       return false;
     }
     
-    Poco::Timestamp timeStamp;
-    std::time_t now = timeStamp.epochTime();
+    //
+    // This runs on every log call.  swarm::Clock is a lot cheaper than
+    // constructing a Poco::Timestamp, more so when the TSC is enabled.
+    //
+    std::time_t now = Clock::epochTime();
     
     if (!force && (now - _lastVerifyTime < _verificationInterval))
     {
@@ -438,5 +1157,3 @@ namespace swarm
   }
 
 } /// swarm
-
-
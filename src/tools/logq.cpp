@@ -0,0 +1,834 @@
+//
+// Copyright (c) eZuce, Inc.
+//
+// Permission is hereby granted, to any person or organization
+// obtaining a copy of the software and accompanying documentation covered by
+// this license (the "Software") to use, execute, and to prepare 
+// derivative works of the Software, all subject to the 
+// "GNU Lesser General Public License (LGPL)".
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+// FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+// DEALINGS IN THE SOFTWARE.
+//
+
+//
+// swarm_logq - search swarm::Logger files
+//
+// Usage: swarm_logq [options] file...
+//
+//   -f, --format FORMAT     format the files were written with
+//                           (default: %h-%M-%S.%i: %t)
+//   -F, --from TIME         first time to report
+//   -T, --to TIME           last time to report
+//   -p, --priority NAME     report this priority and above.  The format
+//                           must contain %p or %q
+//   -s, --substring TEXT    report lines containing TEXT
+//   -e, --regex REGEX       report lines matching the extended REGEX
+//   -r, --rotated           also search the rotated files of each file
+//   -j, --threads N         number of scanning threads
+//   -c, --count             print the number of matching lines only
+//
+// TIME is [YYYY-MM-DD ]HH:MM[:SS[.mmm]] on a 24 hour clock.  The date
+// is only compared if the format contains %Y or %y, %m and %d.  A format
+// with the 12 hour clock %h needs %a or %A to compare times.
+//
+// Files are memory-mapped and split between threads at line boundaries.
+// Lines are located with memchr() and substrings with memmem(), which
+// the C library implements with vector instructions.  When the format
+// starts with a full date and a 24 hour clock the file is sorted by time,
+// so a time range is found by binary search and the rest is not read.
+//
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fcntl.h>
+#include <regex.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+
+
+static const char* DEFAULT_FORMAT = "%h-%M-%S.%i: %t";
+
+static const char* priorityNames[] =
+{
+  "", "Fatal", "Critical", "Error", "Warning", "Notice", "Information", "Debug", "Trace"
+};
+
+static const char priorityLetters[] = " FCEWNIDT";
+
+//
+// The header of a line, as far as the format tells
+//
+struct LineTime
+{
+  int year;
+  int month;
+  int day;
+  int hour;
+  int minute;
+  int second;
+  int microsecond;
+  int priority;
+  int meridiem; /// 1 for am, 2 for pm, 0 if the format has neither
+};
+
+struct FormatItem
+{
+  char spec; /// Format specifier, 0 for literal text
+  std::string literal; /// Literal text
+};
+
+typedef std::vector<FormatItem> Format;
+
+struct Query
+{
+  Format format;
+  bool hasDate; /// Format has the year, month and day
+  bool sorted; /// Format starts with a sortable timestamp
+  bool hasPriority; /// Format has %p or %q
+  bool hasFrom;
+  bool hasTo;
+  bool fromHasDate;
+  bool toHasDate;
+  LineTime from;
+  LineTime to;
+  int priority; /// Report this priority and above.  0 for all
+  std::string substring;
+  bool hasRegex;
+  regex_t regex;
+  unsigned int threads;
+  bool count;
+};
+
+struct Match
+{
+  const char* line;
+  std::size_t length;
+};
+
+typedef std::vector<Match> Matches;
+
+static Format compile_format(const std::string& pattern)
+{
+  Format format;
+  for (std::size_t i = 0; i < pattern.size(); i++)
+  {
+    FormatItem item;
+    item.spec = 0;
+    if (pattern[i] == '%' && i + 1 < pattern.size() && pattern[i + 1] != '%')
+    {
+      item.spec = pattern[++i];
+      if (item.spec == '[')
+      {
+        //
+        // %[name] properties are variable text
+        //
+        std::size_t end = pattern.find(']', i);
+        i = end == std::string::npos ? pattern.size() : end;
+        item.spec = 's';
+      }
+      format.push_back(item);
+      if (item.spec == 't')
+        break; // nothing after the text can be parsed reliably
+      continue;
+    }
+    
+    if (pattern[i] == '%')
+      i++;
+    if (format.empty() || format.back().spec)
+      format.push_back(item);
+    format.back().literal += pattern[i];
+  }
+  return format;
+}
+
+static bool has_spec(const Format& format, const char* specs)
+{
+  for (Format::const_iterator iter = format.begin(); iter != format.end(); iter++)
+  {
+    if (iter->spec && std::strchr(specs, iter->spec))
+      return true;
+  }
+  return false;
+}
+
+static bool read_number(const char*& p, const char* end, int width, int& value)
+{
+  value = 0;
+  int digits = 0;
+  while (p < end && digits < width && *p >= '0' && *p <= '9')
+  {
+    value = value * 10 + (*p++ - '0');
+    digits++;
+  }
+  return digits > 0;
+}
+
+//
+// Converts a 12 hour clock (12, 1 .. 11) to 24 hours once the line told
+// whether it is am or pm
+//
+static bool finish_line(LineTime& time, bool twelveHour)
+{
+  if (twelveHour && time.meridiem)
+    time.hour = time.hour % 12 + (time.meridiem == 2 ? 12 : 0);
+  return true;
+}
+
+static bool parse_line(const Format& format, const char* p, const char* end, LineTime& time)
+{
+  std::memset(&time, 0, sizeof(time));
+  bool twelveHour = false;
+  
+  for (std::size_t i = 0; i < format.size(); i++)
+  {
+    const FormatItem& item = format[i];
+    int value;
+    switch (item.spec)
+    {
+      case 0:
+        if ((std::size_t)(end - p) < item.literal.size() || std::memcmp(p, item.literal.data(), item.literal.size()) != 0)
+          return false;
+        p += item.literal.size();
+        break;
+      case 't':
+        return finish_line(time, twelveHour);
+      case 'Y':
+        if (!read_number(p, end, 4, time.year))
+          return false;
+        break;
+      case 'y':
+        if (!read_number(p, end, 2, value))
+          return false;
+        time.year = 2000 + value;
+        break;
+      case 'm':
+      case 'n':
+        if (!read_number(p, end, 2, time.month))
+          return false;
+        break;
+      case 'd':
+      case 'e':
+        if (!read_number(p, end, 2, time.day))
+          return false;
+        break;
+      case 'H':
+        if (!read_number(p, end, 2, time.hour))
+          return false;
+        break;
+      case 'h':
+        if (!read_number(p, end, 2, time.hour))
+          return false;
+        twelveHour = true;
+        break;
+      case 'a':
+      case 'A':
+        if (end - p < 2 || (p[1] != 'm' && p[1] != 'M'))
+          return false;
+        if (*p == 'a' || *p == 'A')
+          time.meridiem = 1;
+        else if (*p == 'p' || *p == 'P')
+          time.meridiem = 2;
+        else
+          return false;
+        p += 2;
+        break;
+      case 'M':
+        if (!read_number(p, end, 2, time.minute))
+          return false;
+        break;
+      case 'S':
+        if (!read_number(p, end, 2, time.second))
+          return false;
+        break;
+      case 'i':
+        if (!read_number(p, end, 3, value))
+          return false;
+        time.microsecond = value * 1000;
+        break;
+      case 'c':
+        if (!read_number(p, end, 1, value))
+          return false;
+        time.microsecond = value * 100000;
+        break;
+      case 'F':
+        if (!read_number(p, end, 6, time.microsecond))
+          return false;
+        break;
+      case 'q':
+        if (p >= end || !std::strchr(priorityLetters + 1, *p))
+          return false;
+        time.priority = std::strchr(priorityLetters, *p++) - priorityLetters;
+        break;
+      case 'p':
+        for (int prio = 1; prio <= 8; prio++)
+        {
+          std::size_t length = std::strlen(priorityNames[prio]);
+          if ((std::size_t)(end - p) >= length && std::memcmp(p, priorityNames[prio], length) == 0)
+          {
+            time.priority = prio;
+            p += length;
+            break;
+          }
+        }
+        if (!time.priority)
+          return false;
+        break;
+      default:
+        //
+        // Variable text such as the source or the thread name.  It
+        // ends where the next literal starts.
+        //
+        if (i + 1 < format.size() && !format[i + 1].spec)
+        {
+          const char* next = (const char*)memmem(p, end - p, format[i + 1].literal.data(), format[i + 1].literal.size());
+          if (!next)
+            return false;
+          p = next;
+        }
+        break;
+    }
+  }
+  return finish_line(time, twelveHour);
+}
+
+static unsigned long long time_key(const LineTime& time, bool withDate)
+{
+  unsigned long long key = withDate ? ((unsigned long long)time.year * 13 + time.month) * 32 + time.day : 0;
+  key = ((key * 24 + time.hour) * 60 + time.minute) * 60 + time.second;
+  return key * 1000000 + time.microsecond;
+}
+
+static bool parse_time(const char* text, LineTime& time, bool& hasDate)
+{
+  std::memset(&time, 0, sizeof(time));
+  const char* p = text;
+  const char* end = text + std::strlen(text);
+  
+  hasDate = std::strchr(text, '-') != 0;
+  if (hasDate)
+  {
+    if (!read_number(p, end, 4, time.year) || *p++ != '-' ||
+        !read_number(p, end, 2, time.month) || *p++ != '-' ||
+        !read_number(p, end, 2, time.day))
+      return false;
+    while (*p == ' ' || *p == 'T')
+      p++;
+  }
+  
+  if (!read_number(p, end, 2, time.hour) || *p++ != ':' || !read_number(p, end, 2, time.minute))
+    return false;
+  if (*p == ':' && !read_number(++p, end, 2, time.second))
+    return false;
+  if (*p == '.')
+  {
+    int millisecond;
+    if (!read_number(++p, end, 3, millisecond))
+      return false;
+    time.microsecond = millisecond * 1000;
+  }
+  return *p == 0;
+}
+
+static const char* next_line(const char* p, const char* end)
+{
+  const char* newline = (const char*)std::memchr(p, '\n', end - p);
+  return newline ? newline + 1 : end;
+}
+
+static const char* line_start(const char* begin, const char* p)
+{
+  if (p == begin || p[-1] == '\n')
+    return p;
+  const char* newline = (const char*)memrchr(begin, '\n', p - begin);
+  return newline ? newline + 1 : begin;
+}
+
+static bool matches(const Query& query, const char* line, const char* end, bool checkTime)
+{
+  bool needHeader = query.priority || (checkTime && (query.hasFrom || query.hasTo));
+  if (needHeader)
+  {
+    LineTime time;
+    if (!parse_line(query.format, line, end, time))
+      return false;
+    
+    if (query.priority && time.priority > query.priority)
+      return false;
+    
+    if (checkTime && query.hasFrom && time_key(time, query.fromHasDate) < time_key(query.from, query.fromHasDate))
+      return false;
+    
+    if (checkTime && query.hasTo && time_key(time, query.toHasDate) > time_key(query.to, query.toHasDate))
+      return false;
+  }
+  
+  if (!query.substring.empty() && !memmem(line, end - line, query.substring.data(), query.substring.size()))
+    return false;
+  
+  if (query.hasRegex)
+  {
+    regmatch_t match;
+    match.rm_so = 0;
+    match.rm_eo = end - line;
+    if (regexec(&query.regex, line, 1, &match, REG_STARTEND) != 0)
+      return false;
+  }
+  
+  return true;
+}
+
+static void scan(const Query* pQuery, const char* begin, const char* end, bool checkTime, Matches* pMatches)
+{
+  const Query& query = *pQuery;
+  const char* p = begin;
+  
+  while (p < end)
+  {
+    const char* line = p;
+    
+    if (!query.substring.empty())
+    {
+      //
+      // Jump straight to the next occurrence of the substring
+      //
+      const char* hit = (const char*)memmem(p, end - p, query.substring.data(), query.substring.size());
+      if (!hit)
+        break;
+      line = line_start(p, hit);
+    }
+    
+    const char* next = next_line(line, end);
+    const char* lineEnd = next > line && next[-1] == '\n' ? next - 1 : next;
+    if (matches(query, line, lineEnd, checkTime))
+    {
+      Match match;
+      match.line = line;
+      match.length = lineEnd - line;
+      pMatches->push_back(match);
+    }
+    p = next;
+  }
+}
+
+//
+// Returns the first line at or after the first line whose time is not
+// before the key (upper == false) or after the key (upper == true).
+// Lines that do not parse belong to the record before them.
+//
+static const char* search(const Query& query, const char* begin, const char* end, const LineTime& target, bool targetHasDate, bool upper)
+{
+  unsigned long long key = time_key(target, targetHasDate);
+  const char* lo = begin;
+  const char* hi = end;
+  
+  while (lo < hi)
+  {
+    const char* start = line_start(lo, lo + (hi - lo) / 2);
+    
+    const char* line = start;
+    LineTime time;
+    while (line < hi && !parse_line(query.format, line, next_line(line, hi), time))
+      line = next_line(line, hi);
+    
+    if (line < hi && (upper ? time_key(time, targetHasDate) <= key : time_key(time, targetHasDate) < key))
+      lo = next_line(line, hi);
+    else
+      hi = start;
+  }
+  
+  return lo;
+}
+
+static std::size_t search_file(const Query& query, const std::string& path, bool prefix)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1)
+  {
+    std::cerr << "swarm_logq: " << path << ": " << std::strerror(errno) << std::endl;
+    return 0;
+  }
+  
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    return 0;
+  }
+  
+  void* pData = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (pData == MAP_FAILED)
+  {
+    std::cerr << "swarm_logq: " << path << ": " << std::strerror(errno) << std::endl;
+    return 0;
+  }
+  
+  const char* begin = (const char*)pData;
+  const char* end = begin + st.st_size;
+  
+  //
+  // Narrow down the range first if the file is sorted by time
+  //
+  bool checkTime = true;
+  if (query.sorted && (!query.hasFrom || query.fromHasDate) && (!query.hasTo || query.toHasDate))
+  {
+    if (query.hasFrom)
+      begin = search(query, begin, end, query.from, true, false);
+    if (query.hasTo)
+      end = search(query, begin, end, query.to, true, true);
+    checkTime = false;
+  }
+  
+  madvise((void*)((std::size_t)begin & ~(std::size_t)(getpagesize() - 1)), end - begin, MADV_SEQUENTIAL | MADV_WILLNEED);
+  
+  //
+  // Split the range between the threads at line boundaries
+  //
+  unsigned int threads = query.threads;
+  if ((std::size_t)(end - begin) < threads * 1024 * 1024)
+    threads = 1;
+  
+  std::vector<Matches> matches(threads);
+  boost::thread_group group;
+  const char* chunk = begin;
+  for (unsigned int i = 0; i < threads && chunk < end; i++)
+  {
+    const char* chunkEnd = i + 1 == threads ? end : next_line(begin + (end - begin) / threads * (i + 1), end);
+    if (chunkEnd < chunk)
+      chunkEnd = chunk;
+    group.create_thread(boost::bind(&scan, &query, chunk, chunkEnd, checkTime, &matches[i]));
+    chunk = chunkEnd;
+  }
+  group.join_all();
+  
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < matches.size(); i++)
+  {
+    count += matches[i].size();
+    if (query.count)
+      continue;
+    
+    for (Matches::const_iterator iter = matches[i].begin(); iter != matches[i].end(); iter++)
+    {
+      if (prefix)
+      {
+        std::fwrite(path.data(), 1, path.size(), stdout);
+        std::fputc(':', stdout);
+      }
+      std::fwrite(iter->line, 1, iter->length, stdout);
+      std::fputc('\n', stdout);
+    }
+  }
+  
+  if (query.count)
+  {
+    if (prefix)
+      std::cout << path << ":";
+    std::cout << count << std::endl;
+  }
+  
+  munmap(pData, st.st_size);
+  return count;
+}
+
+//
+// A file archived by Poco::FileChannel.  Numbered archives are
+// <path>.<number>, where .0 is the newest.  Timestamped archives are
+// <path>.<YYYYMMDDHHMMSS[mmm]>, and <path>.<timestamp>.<number> if an
+// archive of the same time already existed.
+//
+struct RotatedFile
+{
+  std::string path;
+  unsigned long long timestamp; /// 0 for numbered archives
+  bool numbered;
+  unsigned long long number;
+};
+
+static const std::size_t TIMESTAMP_DIGITS = 14;
+
+static bool read_suffix_number(const std::string& text, unsigned long long& value)
+{
+  if (text.empty() || text.size() > 18 || text.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  value = std::strtoull(text.c_str(), 0, 10);
+  return true;
+}
+
+static bool parse_suffix(const std::string& suffix, RotatedFile& file)
+{
+  std::size_t dot = suffix.find('.');
+  std::string first = suffix.substr(0, dot);
+  unsigned long long value;
+  if (!read_suffix_number(first, value))
+    return false;
+  
+  file.timestamp = 0;
+  file.numbered = false;
+  file.number = 0;
+  
+  if (first.size() >= TIMESTAMP_DIGITS)
+    file.timestamp = value;
+  else if (dot == std::string::npos)
+  {
+    file.numbered = true;
+    file.number = value;
+    return true;
+  }
+  else
+    return false;
+  
+  if (dot != std::string::npos)
+  {
+    file.numbered = true;
+    if (!read_suffix_number(suffix.substr(dot + 1), file.number))
+      return false;
+  }
+  return true;
+}
+
+//
+// Oldest first:  numbered archives before timestamped ones, older
+// timestamps first, and higher numbers first within a timestamp
+//
+static bool older(const RotatedFile& a, const RotatedFile& b)
+{
+  if (a.timestamp != b.timestamp)
+    return a.timestamp < b.timestamp;
+  if (a.numbered != b.numbered)
+    return a.numbered;
+  return a.number > b.number;
+}
+
+static void add_rotated(const std::string& path, std::vector<std::string>& files)
+{
+  boost::filesystem::path base(path);
+  boost::filesystem::path directory = base.parent_path().empty() ? "." : base.parent_path();
+  std::string prefix = base.filename().string() + ".";
+  std::vector<RotatedFile> rotated;
+  
+  boost::system::error_code ec;
+  for (boost::filesystem::directory_iterator iter(directory, ec), last; !ec && iter != last; iter.increment(ec))
+  {
+    std::string name = iter->path().filename().string();
+    if (name.compare(0, prefix.size(), prefix) != 0)
+      continue;
+    
+    std::string suffix = name.substr(prefix.size());
+    bool compressed = suffix.size() > 3 && suffix.compare(suffix.size() - 3, 3, ".gz") == 0;
+    if (compressed)
+      suffix.erase(suffix.size() - 3);
+    
+    //
+    // Skip files that are not archives, such as <path>.lock
+    //
+    RotatedFile file;
+    if (!parse_suffix(suffix, file))
+      continue;
+    
+    if (compressed)
+    {
+      std::cerr << "swarm_logq: " << iter->path().string() << ": compressed, skipped" << std::endl;
+      continue;
+    }
+    
+    file.path = iter->path().string();
+    rotated.push_back(file);
+  }
+  
+  std::sort(rotated.begin(), rotated.end(), older);
+  for (std::vector<RotatedFile>::const_iterator iter = rotated.begin(); iter != rotated.end(); iter++)
+    files.push_back(iter->path);
+  files.push_back(path);
+}
+
+static void usage()
+{
+  std::cerr << "usage: swarm_logq [-f format] [-F from] [-T to] [-p priority] [-s substring] [-e regex] [-r] [-j threads] [-c] file..." << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  Query query;
+  std::string format = DEFAULT_FORMAT;
+  std::string regex;
+  bool rotated = false;
+  std::vector<std::string> paths;
+  
+  query.hasFrom = false;
+  query.hasTo = false;
+  query.priority = 0;
+  query.hasRegex = false;
+  query.threads = boost::thread::hardware_concurrency();
+  query.count = false;
+  
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    
+    if ((arg == "-f" || arg == "--format") && hasValue)
+    {
+      format = argv[++i];
+    }
+    else if ((arg == "-F" || arg == "--from") && hasValue)
+    {
+      if (!parse_time(argv[++i], query.from, query.fromHasDate))
+      {
+        std::cerr << "swarm_logq: invalid time " << argv[i] << std::endl;
+        return 2;
+      }
+      query.hasFrom = true;
+    }
+    else if ((arg == "-T" || arg == "--to") && hasValue)
+    {
+      if (!parse_time(argv[++i], query.to, query.toHasDate))
+      {
+        std::cerr << "swarm_logq: invalid time " << argv[i] << std::endl;
+        return 2;
+      }
+      query.hasTo = true;
+    }
+    else if ((arg == "-p" || arg == "--priority") && hasValue)
+    {
+      std::string name = argv[++i];
+      for (int prio = 1; prio <= 8; prio++)
+      {
+        if (strncasecmp(name.c_str(), priorityNames[prio], name.size()) == 0 && !name.empty())
+        {
+          query.priority = prio;
+          break;
+        }
+      }
+      if (!query.priority)
+      {
+        std::cerr << "swarm_logq: invalid priority " << name << std::endl;
+        return 2;
+      }
+    }
+    else if ((arg == "-s" || arg == "--substring") && hasValue)
+    {
+      query.substring = argv[++i];
+    }
+    else if ((arg == "-e" || arg == "--regex") && hasValue)
+    {
+      regex = argv[++i];
+      query.hasRegex = true;
+    }
+    else if (arg == "-r" || arg == "--rotated")
+    {
+      rotated = true;
+    }
+    else if ((arg == "-j" || arg == "--threads") && hasValue)
+    {
+      query.threads = std::strtoul(argv[++i], 0, 10);
+    }
+    else if (arg == "-c" || arg == "--count")
+    {
+      query.count = true;
+    }
+    else if (!arg.empty() && arg[0] == '-')
+    {
+      usage();
+      return 2;
+    }
+    else
+    {
+      paths.push_back(arg);
+    }
+  }
+  
+  if (paths.empty())
+  {
+    usage();
+    return 2;
+  }
+  
+  if (query.threads == 0)
+    query.threads = 1;
+  
+  query.format = compile_format(format);
+  query.hasDate = has_spec(query.format, "Yy") && has_spec(query.format, "mn") && has_spec(query.format, "de");
+  query.hasPriority = has_spec(query.format, "pq");
+  
+  //
+  // A line order matches the time order if the date and the 24 hour
+  // clock come before any variable text
+  //
+  query.sorted = false;
+  std::string order;
+  for (Format::const_iterator iter = query.format.begin(); iter != query.format.end(); iter++)
+  {
+    if (!iter->spec)
+      continue;
+    if (!std::strchr("YymndeHMSicF", iter->spec))
+      break;
+    order += iter->spec;
+  }
+  query.sorted = query.hasDate && order.find_first_of("Yy") == 0 && order.find('H') != std::string::npos;
+  
+  if (!query.hasDate)
+  {
+    query.fromHasDate = false;
+    query.toHasDate = false;
+  }
+  
+  //
+  // Without am or pm a 12 hour clock cannot be compared with the
+  // 24 hour times of the query
+  //
+  if ((query.hasFrom || query.hasTo) && has_spec(query.format, "h") && !has_spec(query.format, "aA"))
+  {
+    std::cerr << "swarm_logq: the format has a 12 hour clock (%h) without %a or %A, times cannot be compared" << std::endl;
+    return 2;
+  }
+  
+  if (query.priority && !query.hasPriority)
+  {
+    std::cerr << "swarm_logq: the format has no priority (%p or %q)" << std::endl;
+    return 2;
+  }
+  
+  if (query.hasRegex && regcomp(&query.regex, regex.c_str(), REG_EXTENDED | REG_NOSUB) != 0)
+  {
+    std::cerr << "swarm_logq: invalid regex " << regex << std::endl;
+    return 2;
+  }
+  
+  std::vector<std::string> files;
+  for (std::size_t i = 0; i < paths.size(); i++)
+  {
+    if (rotated)
+      add_rotated(paths[i], files);
+    else
+      files.push_back(paths[i]);
+  }
+  
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < files.size(); i++)
+    total += search_file(query, files[i], files.size() > 1);
+  
+  std::fflush(stdout);
+  
+  if (query.hasRegex)
+    regfree(&query.regex);
+  
+  return total ? 0 : 1;
+}
+